@@ -0,0 +1,18 @@
+#version 450
+
+layout(location = 0) in vec3 i_position;
+layout(location = 0) out vec4 o_position;
+layout(location = 1) out vec2 o_uv;
+layout(location = 2) out vec3 o_normal;
+layout(set = 1, binding = 0) uniform t_matrix
+{
+    mat4 u_matrix;
+};
+
+void main()
+{
+    o_position = vec4(i_position, 1.0);
+    o_uv = vec2(0.0f);
+    o_normal = vec3(0.0f);
+    gl_Position = u_matrix * o_position;
+}
\ No newline at end of file
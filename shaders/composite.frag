@@ -1,5 +1,7 @@
 #version 450
 
+#include "config.h"
+
 layout(location = 0) in vec2 i_uv;
 layout(location = 0) out vec4 o_color;
 layout(set = 2, binding = 0) uniform sampler2D s_color;
@@ -10,7 +12,7 @@ layout(set = 2, binding = 3) uniform sampler2D s_light;
 float get_light(
     const vec3 position)
 {
-    const int kernel = 2;
+    const int kernel = QUALITY_LIGHT_KERNEL;
     const vec2 size = 1.0f / vec2(textureSize(s_normal, 0));
     float light = 0.0f;
     for (int x = -kernel; x <= kernel; x++)
@@ -38,7 +40,7 @@ float get_ssao(
     const vec3 position,
     const vec3 normal)
 {
-    const int kernel = 4;
+    const int kernel = QUALITY_SSAO_KERNEL;
     const vec2 size = 1.0f / vec2(textureSize(s_normal, 0));
     float ssao = 0.0f;
     for (int x = -kernel; x <= kernel; x++)
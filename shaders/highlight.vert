@@ -1,8 +1,6 @@
 #version 450
 
-layout(location = 0) in vec3 i_position;
-layout(location = 1) in vec2 i_uv;
-layout(location = 2) in vec3 i_normal;
+layout(location = 0) in ivec4 i_vertex;
 layout(location = 0) out vec3 o_position;
 layout(set = 1, binding = 0) uniform t_matrix
 {
@@ -15,7 +13,7 @@ layout(set = 1, binding = 1) uniform t_instance
 
 void main()
 {
-    o_position = i_position;
+    o_position = vec3(i_vertex.xyz);
     gl_Position = u_matrix * vec4(u_instance + o_position, 1.0f);
     gl_Position.z -= 0.001f;
 }
\ No newline at end of file
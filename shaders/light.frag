@@ -47,7 +47,7 @@ float get_ray_light(
     vec3 direction = dst - src;
     /* TODO: with texel alignment and PCF, it seems like I can raise the step
     size without any noticeable loss in accuracy. should verify */
-    const float step1 = 1.0f;
+    const float step1 = QUALITY_RAY_STEP;
     const vec2 step2 = step1 / vec2(textureSize(s_ray_position_front, 0));
     const float intensity = spread / 4.0f;
     const float spread2 = length(direction.xz);
@@ -71,7 +71,7 @@ float get_ray_light(
         return 0.0f;
     }
     /* bias forwards slightly to ensure walls get lighting */
-    const float bias = 1.0f;
+    const float bias = LIGHT_RAY_BIAS;
     vec2 j = bias / step1 * step2;
     for (float i = bias; i < spread3 - penetration3; i += step1, j += step2)
     {
@@ -105,7 +105,7 @@ float get_sun_light(
     uv.xy = uv.xy * 0.5f + 0.5f;
     uv.y = 1.0f - uv.y;
     const float nearest = texture(s_sun_depth, uv.xy).x;
-    return float(depth - 0.005f < nearest) / 2.0f;
+    return float(depth - LIGHT_SUN_BIAS < nearest) / 2.0f;
 }
 
 void main()
@@ -115,7 +115,7 @@ void main()
     vec4 uv = u_ray_matrix * vec4(position, 1.0f);
     uv.xy = uv.xy * 0.5f + 0.5f;
     uv.y = 1.0f - uv.y;
-    o_light = 0.2f;
+    o_light = LIGHT_AMBIENT;
     o_light = max(o_light, get_sun_light(position, normal) / 2.0f);
     for (int i = 0; i < u_num_lights && o_light < 1.0f; i++)
     {
@@ -6,11 +6,11 @@ layout(location = 2) in vec3 i_normal;
 layout(location = 0) out vec4 o_color;
 layout(location = 1) out vec4 o_position;
 layout(location = 2) out vec4 o_normal;
-layout(set = 2, binding = 0) uniform sampler2D s_palette;
+layout(set = 2, binding = 0) uniform sampler2DArray s_palette;
 
 void main()
 {
-    o_color = texture(s_palette, i_uv);
+    o_color = texture(s_palette, vec3(i_uv.x, 0.5, i_uv.y));
     o_position = i_position;
     o_normal = vec4(i_normal, 0.0);
 }
\ No newline at end of file
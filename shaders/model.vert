@@ -1,9 +1,9 @@
 #version 450
 
-layout(location = 0) in vec3 i_position;
-layout(location = 1) in vec2 i_uv;
-layout(location = 2) in vec3 i_normal;
-layout(location = 3) in vec4 i_instance;
+#include "config.h"
+
+layout(location = 0) in ivec4 i_vertex;
+layout(location = 1) in ivec4 i_instance;
 layout(location = 0) out vec4 o_position;
 layout(location = 1) out vec2 o_uv;
 layout(location = 2) out vec3 o_normal;
@@ -11,12 +11,21 @@ layout(set = 1, binding = 0) uniform t_matrix
 {
     mat4 u_matrix;
 };
+layout(set = 1, binding = 1) uniform t_origin
+{
+    ivec2 u_origin;
+};
 
 void main()
 {
-    o_position = vec4(i_position + i_instance.xyz, 1.0);
-    o_uv = i_uv;
-    o_normal = i_normal;
+    const ivec2 instance = (u_origin + i_instance.xy) * MODEL_SIZE;
+    const int data = i_vertex.w & 0xFFFF;
+    const int palette = data & ((1 << MODEL_NORMAL_SHIFT) - 1);
+    const int normal = data >> MODEL_NORMAL_SHIFT;
+    o_position = vec4(vec3(i_vertex.xyz) + vec3(instance.x, 0.0f, instance.y), 1.0);
+    o_uv.x = (float(palette) + 0.5f) / float(MODEL_PALETTE_SIZE);
+    o_uv.y = float(i_instance.z);
+    o_normal = vec3(equal(ivec3(normal / 2), ivec3(0, 1, 2))) * (normal % 2 == 0 ? 1.0f : -1.0f);
     gl_Position = u_matrix * o_position;
     const vec3 up = vec3(0.0f, 1.0f, 0.0f);
     const float factor = max(dot(up, o_normal), 0.0f);
@@ -0,0 +1,420 @@
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "benchmark.h"
+#include "config.h"
+#include "database.h"
+#include "helpers.h"
+#include "model.h"
+#include "pool.h"
+#include "renderer.h"
+#include "world.h"
+
+#define SIZE 1024
+#define ITERATIONS 16
+#define REGISTRY_SIZE 1000
+
+static void fill_world(
+    SDL_GPUDevice* device)
+{
+    world_update(device, 0.0f, 0.0f, SIZE * MODEL_SIZE, SIZE * MODEL_SIZE);
+    for (int x = 0; x < SIZE; x++)
+    {
+        for (int z = 0; z < SIZE; z++)
+        {
+            const uint32_t hash = (x * 73856093u) ^ (z * 19349663u);
+            if (hash % 4)
+            {
+                continue;
+            }
+            world_set_model((hash / 4) % model_get_count(), x, z);
+        }
+    }
+}
+
+/* the sweeps resize the pool, everything after them expects the default */
+static void restore_pool()
+{
+    pool_free();
+    if (!pool_init(SDL_GetNumLogicalCPUCores()))
+    {
+        SDL_Log("Failed to initialize pool");
+    }
+}
+
+static void benchmark_world_update(
+    SDL_GPUDevice* device)
+{
+    const int threads[] = { 1, 2, 4, 8 };
+    fill_world(device);
+    for (size_t i = 0; i < arrlen(threads); i++)
+    {
+        pool_free();
+        if (!pool_init(threads[i]))
+        {
+            SDL_Log("Failed to initialize pool");
+            break;
+        }
+        uint64_t total = 0;
+        for (int j = 0; j < ITERATIONS; j++)
+        {
+            /* edits would only patch their chunks, so force a full rebuild */
+            world_invalidate();
+            const uint64_t start = SDL_GetPerformanceCounter();
+            world_update(device, 0.0f, 0.0f, SIZE * MODEL_SIZE, SIZE * MODEL_SIZE);
+            total += SDL_GetPerformanceCounter() - start;
+        }
+        const double ms = total * 1000.0 / SDL_GetPerformanceFrequency() / ITERATIONS;
+        SDL_Log("world_update: %dx%d, %d thread(s), %.3f ms", SIZE, SIZE, threads[i], ms);
+    }
+    restore_pool();
+}
+
+static void benchmark_world_count(
+    SDL_GPUDevice* device)
+{
+    const int threads[] = { 1, 8 };
+    fill_world(device);
+    world_update(device, 0.0f, 0.0f, SIZE * MODEL_SIZE, SIZE * MODEL_SIZE);
+    for (size_t i = 0; i < arrlen(threads); i++)
+    {
+        pool_free();
+        if (!pool_init(threads[i]))
+        {
+            SDL_Log("Failed to initialize pool");
+            break;
+        }
+        int* counts = malloc(model_get_count() * sizeof(int));
+        if (!counts)
+        {
+            SDL_Log("Failed to allocate counts");
+            break;
+        }
+        int lights = 0;
+        const uint64_t start = SDL_GetPerformanceCounter();
+        for (int j = 0; j < ITERATIONS; j++)
+        {
+            lights = world_count(counts);
+        }
+        const uint64_t total = SDL_GetPerformanceCounter() - start;
+        free(counts);
+        const double ms = total * 1000.0 / SDL_GetPerformanceFrequency() / ITERATIONS;
+        SDL_Log("world_count: %dx%d, %d thread(s), %d lights, %.3f ms", SIZE, SIZE, threads[i], lights, ms);
+    }
+    restore_pool();
+}
+
+static void benchmark_painting(
+    SDL_GPUDevice* device)
+{
+    float x1;
+    float z1;
+    float x2;
+    float z2;
+    renderer_update(0.0f, 0.0f);
+    renderer_get_bounds(&x1, &z1, &x2, &z2);
+    world_update(device, x1, z1, x2, z2);
+    const int x = floorf((x1 + x2) / 2.0f / MODEL_SIZE);
+    const int z = floorf((z1 + z2) / 2.0f / MODEL_SIZE);
+    const model_t models[2] = { model_find("rock1"), model_find("rock2") };
+    if (models[0] == MODEL_NONE || models[1] == MODEL_NONE)
+    {
+        SDL_Log("Failed to find models");
+        return;
+    }
+    uint64_t total = 0;
+    for (int i = 0; i < ITERATIONS * 4; i++)
+    {
+        /* a drag repeats the same tile for a few frames before moving on */
+        const uint64_t start = SDL_GetPerformanceCounter();
+        world_set_model(models[(i / 4) % 2], x + i / 4, z);
+        world_update(device, x1, z1, x2, z2);
+        database_update();
+        total += SDL_GetPerformanceCounter() - start;
+    }
+    const double ms = total * 1000.0 / SDL_GetPerformanceFrequency() / (ITERATIONS * 4);
+    SDL_Log("painting: %.3f ms per frame", ms);
+}
+
+static int count_tiles(
+    const float polygon[][2],
+    const int count,
+    const float x1,
+    const float z1,
+    const float x2,
+    const float z2)
+{
+    int tiles = 0;
+    for (int x = floorf(x1 / MODEL_SIZE); x < ceilf(x2 / MODEL_SIZE); x++)
+    {
+        for (int z = floorf(z1 / MODEL_SIZE); z < ceilf(z2 / MODEL_SIZE); z++)
+        {
+            tiles += !polygon || camera_intersect_polygon(
+                polygon,
+                count,
+                x * MODEL_SIZE - MODEL_SIZE / 2.0f,
+                z * MODEL_SIZE - MODEL_SIZE / 2.0f,
+                x * MODEL_SIZE + MODEL_SIZE / 2.0f,
+                z * MODEL_SIZE + MODEL_SIZE / 2.0f);
+        }
+    }
+    return tiles;
+}
+
+static void benchmark_view()
+{
+    float polygon[CAMERA_MAX_POLYGON][2];
+    float x1;
+    float z1;
+    float x2;
+    float z2;
+    renderer_update(0.0f, 0.0f);
+    renderer_get_bounds(&x1, &z1, &x2, &z2);
+    const int window = count_tiles(NULL, 0, x1, z1, x2, z2);
+    const int count = renderer_get_polygon(polygon);
+    x1 = x2 = polygon[0][0];
+    z1 = z2 = polygon[0][1];
+    for (int i = 1; i < count; i++)
+    {
+        x1 = min(x1, polygon[i][0]);
+        z1 = min(z1, polygon[i][1]);
+        x2 = max(x2, polygon[i][0]);
+        z2 = max(z2, polygon[i][1]);
+    }
+    const int aabb = count_tiles(NULL, 0, x1, z1, x2, z2);
+    const int view = count_tiles(polygon, count, x1, z1, x2, z2);
+    SDL_Log("view: window %d tiles, aabb %d tiles, polygon %d tiles", window, aabb, view);
+}
+
+static void fill_occluders(
+    const int density,
+    const float x1,
+    const float z1,
+    const float x2,
+    const float z2)
+{
+    const char* names[] =
+    {
+        "rock1",
+        "rock2",
+        "rock3",
+        "rock4",
+        "rock5",
+        "tree1",
+        "tree2",
+        "tree3",
+        "lighthouse",
+    };
+    model_t occluders[arrlen(names)];
+    for (size_t i = 0; i < arrlen(names); i++)
+    {
+        occluders[i] = model_find(names[i]);
+        if (occluders[i] == MODEL_NONE)
+        {
+            SDL_Log("Failed to find model: %s", names[i]);
+            return;
+        }
+    }
+    for (int x = floorf(x1 / MODEL_SIZE); x < ceilf(x2 / MODEL_SIZE); x++)
+    {
+        for (int z = floorf(z1 / MODEL_SIZE); z < ceilf(z2 / MODEL_SIZE); z++)
+        {
+            const uint32_t hash = (x * 73856093u) ^ (z * 19349663u);
+            model_t model = 0;
+            if ((int) (hash % 100) < density)
+            {
+                model = occluders[(hash / 100) % arrlen(occluders)];
+            }
+            world_set_model(model, x, z);
+        }
+    }
+}
+
+static void set_batched(
+    const bool batched)
+{
+    world_set_batched(WORLD_PASS_RAY_MODEL_FRONT, batched);
+    world_set_batched(WORLD_PASS_RAY_MODEL_BACK, batched);
+    world_set_batched(WORLD_PASS_SUN_MODEL, batched);
+}
+
+static void benchmark_batching(
+    SDL_GPUDevice* device)
+{
+    const int densities[] = { 5, 20, 50 };
+    const bool ray = world_get_batched(WORLD_PASS_RAY_MODEL_FRONT);
+    const bool sun = world_get_batched(WORLD_PASS_SUN_MODEL);
+    float x1;
+    float z1;
+    float x2;
+    float z2;
+    renderer_update(0.0f, 0.0f);
+    renderer_get_bounds(&x1, &z1, &x2, &z2);
+    for (size_t i = 0; i < arrlen(densities); i++)
+    {
+        fill_occluders(densities[i], x1, z1, x2, z2);
+        for (int j = 0; j < 2; j++)
+        {
+            /* switching modes rebuilds every chunk, which times the bake */
+            set_batched(j);
+            uint64_t start = SDL_GetPerformanceCounter();
+            world_update(device, x1, z1, x2, z2);
+            const uint64_t update = SDL_GetPerformanceCounter() - start;
+            renderer_draw();
+            renderer_composite();
+            SDL_WaitForGPUIdle(device);
+            start = SDL_GetPerformanceCounter();
+            for (int k = 0; k < ITERATIONS; k++)
+            {
+                renderer_composite();
+                SDL_WaitForGPUIdle(device);
+            }
+            const uint64_t composite = SDL_GetPerformanceCounter() - start;
+            const double frequency = SDL_GetPerformanceFrequency();
+            SDL_Log("batching: %d%% occluders, %s, world_update %.3f ms, composite %.3f ms",
+                densities[i],
+                j ? "batched" : "instanced",
+                update * 1000.0 / frequency,
+                composite * 1000.0 / frequency / ITERATIONS);
+        }
+    }
+    world_set_batched(WORLD_PASS_RAY_MODEL_FRONT, ray);
+    world_set_batched(WORLD_PASS_RAY_MODEL_BACK, ray);
+    world_set_batched(WORLD_PASS_SUN_MODEL, sun);
+}
+
+static void benchmark_quality(
+    SDL_GPUDevice* device)
+{
+    /* the tiers only differ in the light and composite shaders, so the change
+    in composite time is their cost */
+    const int quality = renderer_get_quality();
+    float x1;
+    float z1;
+    float x2;
+    float z2;
+    renderer_update(0.0f, 0.0f);
+    renderer_get_bounds(&x1, &z1, &x2, &z2);
+    fill_occluders(20, x1, z1, x2, z2);
+    world_update(device, x1, z1, x2, z2);
+    for (int i = 0; i < QUALITY_COUNT; i++)
+    {
+        if (!renderer_set_quality(i))
+        {
+            break;
+        }
+        renderer_draw();
+        renderer_composite();
+        SDL_WaitForGPUIdle(device);
+        const uint64_t start = SDL_GetPerformanceCounter();
+        for (int j = 0; j < ITERATIONS; j++)
+        {
+            renderer_composite();
+            SDL_WaitForGPUIdle(device);
+        }
+        const uint64_t total = SDL_GetPerformanceCounter() - start;
+        const double ms = total * 1000.0 / SDL_GetPerformanceFrequency() / ITERATIONS;
+        SDL_Log("quality: %s, composite %.3f ms", renderer_get_quality_str(i), ms);
+    }
+    renderer_set_quality(quality);
+}
+
+static void fill_types(
+    const int count,
+    const float x1,
+    const float z1,
+    const float x2,
+    const float z2)
+{
+    for (int x = floorf(x1 / MODEL_SIZE); x < ceilf(x2 / MODEL_SIZE); x++)
+    {
+        for (int z = floorf(z1 / MODEL_SIZE); z < ceilf(z2 / MODEL_SIZE); z++)
+        {
+            const uint32_t hash = (x * 73856093u) ^ (z * 19349663u);
+            world_set_model(hash % count, x, z);
+        }
+    }
+}
+
+static void benchmark_registry(
+    SDL_GPUDevice* device)
+{
+    /* aliases of the real models stand in for content, each one a type of its
+    own to the world. registered last since they stay for the session */
+    const int count = model_get_count();
+    float x1;
+    float z1;
+    float x2;
+    float z2;
+    renderer_update(0.0f, 0.0f);
+    renderer_get_bounds(&x1, &z1, &x2, &z2);
+    for (int i = 0; i < 2; i++)
+    {
+        for (int j = model_get_count(); i && j < REGISTRY_SIZE; j++)
+        {
+            const model_t model = j % count;
+            char name[64];
+            char mesh[64];
+            snprintf(name, sizeof(name), "bench%d", j);
+            snprintf(mesh, sizeof(mesh), "%s.vox", model_get_str(model));
+            if (model_register(name, mesh, NULL, model_get_spread(model), model_get_passes(model)) == MODEL_NONE)
+            {
+                return;
+            }
+        }
+        /* everything in view is loaded before timing so no upload lands in it */
+        fill_types(model_get_count(), x1, z1, x2, z2);
+        world_update(device, x1, z1, x2, z2);
+        model_wait();
+        world_update(device, x1, z1, x2, z2);
+        uint64_t update = 0;
+        uint64_t frame = 0;
+        for (int j = 0; j < ITERATIONS; j++)
+        {
+            /* edits would only patch their chunks, so force a full rebuild */
+            world_invalidate();
+            uint64_t start = SDL_GetPerformanceCounter();
+            world_update(device, x1, z1, x2, z2);
+            update += SDL_GetPerformanceCounter() - start;
+            /* culling and recording only, the gpu is waited on outside */
+            start = SDL_GetPerformanceCounter();
+            renderer_draw();
+            renderer_composite();
+            frame += SDL_GetPerformanceCounter() - start;
+            SDL_WaitForGPUIdle(device);
+        }
+        const double frequency = SDL_GetPerformanceFrequency();
+        SDL_Log("registry: %d types, world_update %.3f ms, draw and composite %.3f ms",
+            model_get_count(),
+            update * 1000.0 / frequency / ITERATIONS,
+            frame * 1000.0 / frequency / ITERATIONS);
+    }
+}
+
+void benchmark_run(
+    SDL_GPUDevice* device)
+{
+    assert(device);
+    /* measure the real meshes and passes rather than the placeholders */
+    for (model_t model = 0; model < model_get_count(); model++)
+    {
+        model_request(model);
+    }
+    model_wait();
+    renderer_wait();
+    if (renderer_get_state() != RENDERER_STATE_LOADED)
+    {
+        SDL_Log("Failed to create pipelines");
+        return;
+    }
+    benchmark_world_update(device);
+    benchmark_world_count(device);
+    benchmark_view();
+    benchmark_painting(device);
+    benchmark_batching(device);
+    benchmark_quality(device);
+    benchmark_registry(device);
+}
\ No newline at end of file
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+void benchmark_run(
+    SDL_GPUDevice* device);
\ No newline at end of file
@@ -12,6 +12,70 @@ enum
     BOTTOM_RIGHT,
 };
 
+static float cross(
+    const float o[2],
+    const float a[2],
+    const float b[2])
+{
+    return (a[0] - o[0]) * (b[1] - o[1]) - (a[1] - o[1]) * (b[0] - o[0]);
+}
+
+/* monotone chain, counter clockwise without collinear points */
+static int hull(
+    float polygon[CAMERA_MAX_POLYGON][2],
+    float points[CAMERA_MAX_POLYGON][2],
+    const int count)
+{
+    for (int i = 1; i < count; i++)
+    {
+        for (int j = i; j > 0; j--)
+        {
+            const float* a = points[j - 1];
+            const float* b = points[j];
+            if (a[0] < b[0] || (a[0] == b[0] && a[1] <= b[1]))
+            {
+                break;
+            }
+            const float x = b[0];
+            const float z = b[1];
+            points[j][0] = a[0];
+            points[j][1] = a[1];
+            points[j - 1][0] = x;
+            points[j - 1][1] = z;
+        }
+    }
+    float chain[CAMERA_MAX_POLYGON * 2][2];
+    int n = 0;
+    for (int i = 0; i < count; i++)
+    {
+        while (n >= 2 && cross(chain[n - 2], chain[n - 1], points[i]) <= 0.0f)
+        {
+            n--;
+        }
+        chain[n][0] = points[i][0];
+        chain[n][1] = points[i][1];
+        n++;
+    }
+    const int lower = n + 1;
+    for (int i = count - 2; i >= 0; i--)
+    {
+        while (n >= lower && cross(chain[n - 2], chain[n - 1], points[i]) <= 0.0f)
+        {
+            n--;
+        }
+        chain[n][0] = points[i][0];
+        chain[n][1] = points[i][1];
+        n++;
+    }
+    n = max(n - 1, 0);
+    for (int i = 0; i < n; i++)
+    {
+        polygon[i][0] = chain[i][0];
+        polygon[i][1] = chain[i][1];
+    }
+    return n;
+}
+
 static void multiply(
     float matrix[4][4],
     const float a[4][4],
@@ -306,6 +370,14 @@ void camera_update(
             camera->far);
     }
     multiply(camera->matrix, camera->proj, camera->view);
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            camera->planes[i * 2 + 0][j] = camera->matrix[j][3] + camera->matrix[j][i];
+            camera->planes[i * 2 + 1][j] = camera->matrix[j][3] - camera->matrix[j][i];
+        }
+    }
     if (camera->type != CAMERA_TYPE_PERSPECTIVE)
     {
         return;
@@ -326,6 +398,19 @@ void camera_update(
         [TOP_RIGHT] = 0.0f,
         [BOTTOM_RIGHT] = MODEL_MAX_HEIGHT,
     };
+    /* the exact footprint is every corner ray between the ground and the
+    tallest model, the aabb above only keeps the extreme ones */
+    float points[CAMERA_MAX_POLYGON][2];
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 2; j++)
+        {
+            float* point = points[i * 2 + j];
+            point[0] = camera->bounds[i][0];
+            point[1] = camera->bounds[i][1];
+            camera_project(camera, &point[0], &point[1], j * MODEL_MAX_HEIGHT);
+        }
+    }
     for (int i = 0; i < 4; i++)
     {
         camera_project(
@@ -334,6 +419,7 @@ void camera_update(
             &camera->bounds[i][1],
             y[i]);
     }
+    camera->num_polygon = hull(camera->polygon, points, CAMERA_MAX_POLYGON);
 }
 
 void camera_set_target(
@@ -432,4 +518,91 @@ void camera_get_bounds(
     *z1 = min(*z1, camera->bounds[BOTTOM_LEFT][1]);
     *x2 = max(*x2, camera->bounds[BOTTOM_RIGHT][0]);
     *z2 = max(*z2, camera->bounds[BOTTOM_RIGHT][1]);
+}
+
+bool camera_intersect_box(
+    const camera_t* camera,
+    const float x1,
+    const float y1,
+    const float z1,
+    const float x2,
+    const float y2,
+    const float z2)
+{
+    assert(camera);
+    assert(camera->type != CAMERA_TYPE_ORTHO_2D);
+    for (int i = 0; i < 6; i++)
+    {
+        /* test the corner furthest along the plane normal */
+        const float* plane = camera->planes[i];
+        const float x = plane[0] > 0.0f ? x2 : x1;
+        const float y = plane[1] > 0.0f ? y2 : y1;
+        const float z = plane[2] > 0.0f ? z2 : z1;
+        if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int camera_get_polygon(
+    const camera_t* camera,
+    float polygon[CAMERA_MAX_POLYGON][2])
+{
+    assert(camera);
+    assert(camera->type == CAMERA_TYPE_PERSPECTIVE);
+    assert(polygon);
+    for (int i = 0; i < camera->num_polygon; i++)
+    {
+        polygon[i][0] = camera->polygon[i][0];
+        polygon[i][1] = camera->polygon[i][1];
+    }
+    return camera->num_polygon;
+}
+
+bool camera_intersect_polygon(
+    const float polygon[][2],
+    const int count,
+    const float x1,
+    const float z1,
+    const float x2,
+    const float z2)
+{
+    assert(polygon || !count);
+    if (count < 3)
+    {
+        return false;
+    }
+    /* separating axes are the rectangle's and the edge normals */
+    float a1 = polygon[0][0];
+    float b1 = polygon[0][1];
+    float a2 = polygon[0][0];
+    float b2 = polygon[0][1];
+    for (int i = 1; i < count; i++)
+    {
+        a1 = min(a1, polygon[i][0]);
+        b1 = min(b1, polygon[i][1]);
+        a2 = max(a2, polygon[i][0]);
+        b2 = max(b2, polygon[i][1]);
+    }
+    if (a2 < x1 || b2 < z1 || a1 > x2 || b1 > z2)
+    {
+        return false;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        /* counter clockwise, so the outward normal is (dz, -dx) */
+        const float* p = polygon[i];
+        const float* q = polygon[(i + 1) % count];
+        const float nx = q[1] - p[1];
+        const float nz = p[0] - q[0];
+        const float x = nx > 0.0f ? x1 : x2;
+        const float z = nz > 0.0f ? z1 : z2;
+        if ((x - p[0]) * nx + (z - p[1]) * nz > 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
 }
\ No newline at end of file
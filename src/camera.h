@@ -2,6 +2,8 @@
 
 #include <stdbool.h>
 
+#define CAMERA_MAX_POLYGON 8
+
 typedef enum
 {
     CAMERA_TYPE_PERSPECTIVE,
@@ -18,6 +20,9 @@ typedef struct
     float proj[4][4];
     float inverse[4][4];
     float bounds[4][2];
+    float polygon[CAMERA_MAX_POLYGON][2];
+    int num_polygon;
+    float planes[6][4];
     float x;
     float y;
     float z;
@@ -68,4 +73,22 @@ void camera_get_bounds(
     float* x1,
     float* z1,
     float* x2,
-    float* z2);
\ No newline at end of file
+    float* z2);
+bool camera_intersect_box(
+    const camera_t* camera,
+    const float x1,
+    const float y1,
+    const float z1,
+    const float x2,
+    const float y2,
+    const float z2);
+int camera_get_polygon(
+    const camera_t* camera,
+    float polygon[CAMERA_MAX_POLYGON][2]);
+bool camera_intersect_polygon(
+    const float polygon[][2],
+    const int count,
+    const float x1,
+    const float z1,
+    const float x2,
+    const float z2);
\ No newline at end of file
@@ -11,8 +11,43 @@
 #define RENDERER_SUN_RESOLUTION_Y 1024
 #define MODEL_SIZE 16
 #define MODEL_MAX_HEIGHT 32
+#define MODEL_PALETTE_SIZE 256
+#define MODEL_NORMAL_SHIFT 13
+#define MODEL_PROXY_SCALE 2
+#define MODEL_MANIFEST "models.txt"
+#define WORLD_CHUNK_SIZE 16
+#define WORLD_BATCH_RAY 0
+#define WORLD_BATCH_SUN 0
 #define DATABASE_PATH "prototype.sqlite3"
+#define VFS_PATH "prototype.pack"
+#define DATABASE_COMMIT_INTERVAL 1000
 #define PICK_BIAS 0.01f
 #define SPEED 500.0f
+#define STATS_INTERVAL 5000
+#define STATS_LOG 0
+#define LIGHT_AMBIENT 0.2f
+#define LIGHT_RAY_BIAS 1.0f
+#define LIGHT_SUN_BIAS 0.005f
+
+/* light and composite shaders are built once per tier with QUALITY defined,
+the tier is read from QUALITY_PATH at startup */
+#define QUALITY_LOW 0
+#define QUALITY_MEDIUM 1
+#define QUALITY_HIGH 2
+#define QUALITY_COUNT 3
+#define QUALITY_PATH "quality.txt"
+#if defined(QUALITY) && QUALITY == QUALITY_LOW
+#define QUALITY_RAY_STEP 2.0f
+#define QUALITY_LIGHT_KERNEL 1
+#define QUALITY_SSAO_KERNEL 2
+#elif defined(QUALITY) && QUALITY == QUALITY_MEDIUM
+#define QUALITY_RAY_STEP 1.5f
+#define QUALITY_LIGHT_KERNEL 1
+#define QUALITY_SSAO_KERNEL 3
+#elif defined(QUALITY)
+#define QUALITY_RAY_STEP 1.0f
+#define QUALITY_LIGHT_KERNEL 2
+#define QUALITY_SSAO_KERNEL 4
+#endif
 
 #endif
\ No newline at end of file
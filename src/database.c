@@ -3,6 +3,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include "config.h"
 #include "database.h"
 #include "helpers.h"
 #include "model.h"
@@ -12,6 +13,8 @@ static sqlite3_stmt* set_state_stmt;
 static sqlite3_stmt* get_state_stmt;
 static sqlite3_stmt* set_model_stmt;
 static sqlite3_stmt* get_models_stmt;
+static uint64_t committed;
+static bool pending;
 
 bool database_init(
     const char* path)
@@ -97,10 +100,13 @@ void database_free()
     set_model_stmt = NULL;
     get_models_stmt = NULL;
     handle = NULL;
+    pending = false;
 }
 
 bool database_commit()
 {
+    committed = SDL_GetTicks();
+    pending = false;
     if (sqlite3_exec(handle, "COMMIT; BEGIN;", 0, 0, 0) != SQLITE_OK)
     {
         SDL_Log("Failed to end transaction: %s", sqlite3_errmsg(handle));
@@ -109,6 +115,16 @@ bool database_commit()
     return true;
 }
 
+/* writes stay in the open transaction and are committed at most once per
+interval, so painting doesn't pay for a sync every frame */
+void database_update()
+{
+    if (pending && SDL_GetTicks() - committed >= DATABASE_COMMIT_INTERVAL)
+    {
+        database_commit();
+    }
+}
+
 void database_set_state(
     const model_t model,
     const float x,
@@ -123,7 +139,7 @@ void database_set_state(
         SDL_Log("Failed to set state: %s", sqlite3_errmsg(handle));
     }
     sqlite3_reset(set_state_stmt);
-    database_commit();
+    pending = true;
 }
 
 void database_get_state(
@@ -163,7 +179,7 @@ void database_set_model(
         SDL_Log("Failed to set model: %s", sqlite3_errmsg(handle));
     }
     sqlite3_reset(set_model_stmt);
-    database_commit();
+    pending = true;
 }
 
 void database_get_models(
@@ -12,6 +12,7 @@ bool database_init(
     const char* path);
 void database_free();
 bool database_commit();
+void database_update();
 void database_set_state(
     const model_t model,
     const float x,
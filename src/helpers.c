@@ -1,11 +1,23 @@
 #include <SDL3/SDL.h>
-#include <spirv_reflect.h>
-#include <stb_image.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include "helpers.h"
+#ifdef SHADER_FILES
+#include "reflect.h"
+#else
+#include "shaders.h"
+#endif
 
+#ifdef SHADER_FILES
 SDL_GPUShader* load_shader(
     SDL_GPUDevice* device,
     const char* file)
@@ -22,44 +34,12 @@ SDL_GPUShader* load_shader(
     }
     info.code = code;
     info.code_size = size;
-    SpvReflectShaderModule module;
-    SpvReflectResult result = spvReflectCreateShaderModule(size, code, &module);
-    if (result != SPV_REFLECT_RESULT_SUCCESS)
+    if (!reflect_shader(&info, file, code, size))
     {
         SDL_Log("Failed to reflect shader: %s", file);
         SDL_free(code);
         return NULL;
     }
-    for (int i = 0; i < module.descriptor_binding_count; i++)
-    {
-        const SpvReflectDescriptorBinding* binding = &module.descriptor_bindings[i];
-        switch (module.descriptor_bindings[i].descriptor_type)
-        {
-        case SPV_REFLECT_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
-            info.num_uniform_buffers++;
-            break;
-        case SPV_REFLECT_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
-            info.num_samplers++;
-            break;
-        case SPV_REFLECT_DESCRIPTOR_TYPE_STORAGE_BUFFER:
-            info.num_storage_buffers++;
-            break;
-        case SPV_REFLECT_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
-            info.num_storage_textures++;
-            break;
-        }
-    }
-    spvReflectDestroyShaderModule(&module);
-    if (strstr(file, ".vert"))
-    {
-        info.stage = SDL_GPU_SHADERSTAGE_VERTEX;
-    }
-    else
-    {
-        info.stage = SDL_GPU_SHADERSTAGE_FRAGMENT;
-    }
-    info.format = SDL_GPU_SHADERFORMAT_SPIRV;
-    info.entrypoint = "main";
     SDL_GPUShader* shader = SDL_CreateGPUShader(device, &info);
     SDL_free(code);
     if (!shader)
@@ -86,60 +66,12 @@ SDL_GPUComputePipeline* load_compute_pipeline(
     }
     info.code = code;
     info.code_size = size;
-    SpvReflectShaderModule module;
-    SpvReflectResult result = spvReflectCreateShaderModule(size, code, &module);
-    if (result != SPV_REFLECT_RESULT_SUCCESS)
+    if (!reflect_compute_pipeline(&info, code, size))
     {
         SDL_Log("Failed to reflect compute pipeline: %s", file);
         SDL_free(code);
         return NULL;
     }
-    const SpvReflectEntryPoint* entry = spvReflectGetEntryPoint(&module, "main");
-    if (!entry)
-    {
-        SDL_Log("Failed to reflect compute pipeline: %s", file);
-        SDL_free(code);
-        return NULL;
-    }
-    info.threadcount_x = entry->local_size.x;
-    info.threadcount_y = entry->local_size.y;
-    info.threadcount_z = entry->local_size.z;
-    for (int i = 0; i < module.descriptor_binding_count; ++i)
-    {
-        const SpvReflectDescriptorBinding* binding = &module.descriptor_bindings[i];
-        switch (binding->descriptor_type)
-        {
-        case SPV_REFLECT_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
-            info.num_uniform_buffers++;
-            break;
-        case SPV_REFLECT_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
-            info.num_samplers++;
-            break;
-        case SPV_REFLECT_DESCRIPTOR_TYPE_STORAGE_BUFFER:
-            if (binding->accessed)
-            {
-                info.num_readwrite_storage_buffers++;
-            }
-            else
-            {
-                info.num_readonly_storage_buffers++;
-            }
-            break;
-        case SPV_REFLECT_DESCRIPTOR_TYPE_STORAGE_IMAGE:
-            if (binding->accessed)
-            {
-                info.num_readwrite_storage_textures++;
-            }
-            else
-            {
-                info.num_readonly_storage_textures++;
-            }
-            break;
-        }
-    }
-    spvReflectDestroyShaderModule(&module);
-    info.format = SDL_GPU_SHADERFORMAT_SPIRV;
-    info.entrypoint = "main";
     SDL_GPUComputePipeline* pipeline = SDL_CreateGPUComputePipeline(device, &info);
     SDL_free(code);
     if (!pipeline)
@@ -149,85 +81,135 @@ SDL_GPUComputePipeline* load_compute_pipeline(
     }
     return pipeline;
 }
+#else
+/* the spirv and create infos are generated at build time by tools/embed.c */
+static const void* get_shader(
+    const char* file)
+{
+#define X(name, info) \
+    if (!strcmp(file, name)) \
+    { \
+        return &info; \
+    }
+    SHADERS
+#undef X
+    return NULL;
+}
 
-SDL_GPUTexture* load_texture(
+SDL_GPUShader* load_shader(
     SDL_GPUDevice* device,
     const char* file)
 {
     assert(device);
     assert(file);
-    int width;
-    int height;
-    int channels;
-    void* src = stbi_load(file, &width, &height, &channels, 4);
-    if (!src)
+    const SDL_GPUShaderCreateInfo* info = get_shader(file);
+    if (!info)
     {
-        SDL_Log("Failed to load image: %s, %s", file, stbi_failure_reason());
+        SDL_Log("Failed to find shader: %s", file);
         return NULL;
     }
-    SDL_GPUTextureCreateInfo tci = {0};
-    tci.usage = SDL_GPU_TEXTUREUSAGE_SAMPLER;
-    tci.type = SDL_GPU_TEXTURETYPE_2D;
-    tci.format = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
-    tci.width = width;
-    tci.height = height;
-    tci.layer_count_or_depth = 1;
-    tci.num_levels = 1;
-    SDL_GPUTexture* texture = SDL_CreateGPUTexture(device, &tci);
-    if (!texture)
-    {
-        SDL_Log("Failed to create texture: %s, %s", file, SDL_GetError());
-        stbi_image_free(src);
+    SDL_GPUShader* shader = SDL_CreateGPUShader(device, info);
+    if (!shader)
+    {
+        SDL_Log("Failed to create shader: %s, %s", file, SDL_GetError());
         return NULL;
     }
-    SDL_GPUTransferBufferCreateInfo tbci = {0};
-    tbci.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
-    tbci.size = width * height * 4;
-    SDL_GPUTransferBuffer* buffer = SDL_CreateGPUTransferBuffer(device, &tbci);
-    if (!buffer)
+    return shader;
+}
+
+SDL_GPUComputePipeline* load_compute_pipeline(
+    SDL_GPUDevice* device,
+    const char* file)
+{
+    assert(device);
+    assert(file);
+    const SDL_GPUComputePipelineCreateInfo* info = get_shader(file);
+    if (!info)
     {
-        SDL_Log("Failed to create transfer buffer: %s, %s", file, SDL_GetError());
-        stbi_image_free(src);
-        SDL_ReleaseGPUTexture(device, texture);
+        SDL_Log("Failed to find compute pipeline: %s", file);
         return NULL;
     }
-    void* dst = SDL_MapGPUTransferBuffer(device, buffer, false);
-    if (!dst)
+    SDL_GPUComputePipeline* pipeline = SDL_CreateGPUComputePipeline(device, info);
+    if (!pipeline)
     {
-        SDL_Log("Failed to map transfer buffer: %s, %s", file, SDL_GetError());
-        stbi_image_free(src);
-        SDL_ReleaseGPUTexture(device, texture);
+        SDL_Log("Failed to create compute pipeline: %s, %s", file, SDL_GetError());
         return NULL;
     }
-    memcpy(dst, src, width * height * 4);
-    SDL_UnmapGPUTransferBuffer(device, buffer);
-    SDL_GPUTextureTransferInfo tti = {0};
-    SDL_GPUTextureRegion region = {0};
-    tti.transfer_buffer = buffer;
-    region.texture = texture;
-    region.w = width;
-    region.h = height;
-    region.d = 1;
-    SDL_GPUCommandBuffer* commands = SDL_AcquireGPUCommandBuffer(device);
-    if (!commands)
-    {
-        SDL_Log("Failed to acquire command buffer: %s, %s", file, SDL_GetError());
-        stbi_image_free(src);
-        SDL_ReleaseGPUTexture(device, texture);
+    return pipeline;
+}
+#endif
+
+void* map_file(
+    const char* file,
+    size_t* size)
+{
+    assert(file);
+    assert(size);
+    void* data = NULL;
+    *size = 0;
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
         return NULL;
     }
-    SDL_GPUCopyPass* copy  = SDL_BeginGPUCopyPass(commands);
-    if (!copy)
+    LARGE_INTEGER length;
+    if (GetFileSizeEx(handle, &length) && length.QuadPart > 0)
+    {
+        HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping)
+        {
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+        *size = data ? length.QuadPart : 0;
+    }
+    CloseHandle(handle);
+#else
+    const int handle = open(file, O_RDONLY);
+    if (handle == -1)
     {
-        SDL_Log("Failed to begin copy pass: %s, %s", file, SDL_GetError());
-        stbi_image_free(src);
-        SDL_ReleaseGPUTexture(device, texture);
-        SDL_CancelGPUCommandBuffer(commands);
         return NULL;
     }
-    SDL_UploadToGPUTexture(copy, &tti, &region, true);
-    SDL_EndGPUCopyPass(copy);
-    SDL_SubmitGPUCommandBuffer(commands);
-    SDL_ReleaseGPUTransferBuffer(device, buffer);
-    return texture;
+    struct stat info;
+    if (!fstat(handle, &info) && info.st_size > 0)
+    {
+        data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, handle, 0);
+        data = data == MAP_FAILED ? NULL : data;
+        *size = data ? info.st_size : 0;
+    }
+    close(handle);
+#endif
+    return data;
+}
+
+void unmap_file(
+    void* data,
+    const size_t size)
+{
+    if (!data)
+    {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+void prefetch_file(
+    const void* data,
+    const size_t size)
+{
+    if (!data)
+    {
+        return;
+    }
+#ifdef _WIN32
+    WIN32_MEMORY_RANGE_ENTRY range = {(void*) data, size};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    madvise((void*) data, size, MADV_WILLNEED);
+#endif
 }
\ No newline at end of file
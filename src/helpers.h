@@ -33,6 +33,12 @@ SDL_GPUShader* load_shader(
 SDL_GPUComputePipeline* load_compute_pipeline(
     SDL_GPUDevice* device,
     const char* file);
-SDL_GPUTexture* load_texture(
-    SDL_GPUDevice* device,
-    const char* file);
\ No newline at end of file
+void* map_file(
+    const char* file,
+    size_t* size);
+void unmap_file(
+    void* data,
+    const size_t size);
+void prefetch_file(
+    const void* data,
+    const size_t size);
\ No newline at end of file
@@ -3,15 +3,21 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+#include "benchmark.h"
 #include "config.h"
 #include "database.h"
 #include "helpers.h"
 #include "renderer.h"
 #include "model.h"
+#include "pool.h"
+#include "stats.h"
+#include "vfs.h"
 #include "world.h"
 
 int main(int argc, char** argv)
 {
+    const uint64_t start = SDL_GetPerformanceCounter();
     if (!SDL_Init(SDL_INIT_VIDEO))
     {
         SDL_Log("Failed to initialize SDL: %s", SDL_GetError());
@@ -29,11 +35,39 @@ int main(int argc, char** argv)
         SDL_Log("Failed to create device: %s", SDL_GetError());
         return false;
     }
+    if (!pool_init(SDL_GetNumLogicalCPUCores()))
+    {
+        SDL_Log("Failed to initialize pool");
+        return EXIT_FAILURE;
+    }
+    if (!vfs_init(VFS_PATH))
+    {
+        SDL_Log("Failed to initialize vfs");
+        return EXIT_FAILURE;
+    }
     if (!renderer_init(window, device))
     {
         SDL_Log("Failed to initialize renderer");
         return EXIT_FAILURE;
     }
+    if (argc > 1 && !strcmp(argv[1], "--benchmark"))
+    {
+        if (!database_init(":memory:"))
+        {
+            SDL_Log("Failed to initialize database");
+            return EXIT_FAILURE;
+        }
+        benchmark_run(device);
+        world_free(device);
+        database_free();
+        renderer_free();
+        vfs_free();
+        pool_free();
+        SDL_DestroyGPUDevice(device);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return EXIT_SUCCESS;
+    }
     if (!database_init(DATABASE_PATH))
     {
         SDL_Log("Failed to initialize database");
@@ -43,9 +77,16 @@ int main(int argc, char** argv)
     float x;
     float z;
     database_get_state(&selected, &x, &z);
+    if (selected >= model_get_count())
+    {
+        selected = 0;
+    }
     SDL_SetWindowResizable(window, true);
     SDL_SetWindowTitle(window, model_get_str(selected));
     bool running = true;
+    int status = EXIT_SUCCESS;
+    bool first = true;
+    bool loaded = false;
     uint64_t t1 = SDL_GetPerformanceCounter();
     uint64_t t2 = 0;
     while (running)
@@ -63,18 +104,14 @@ int main(int argc, char** argv)
                 running = false;
                 break;
             case SDL_EVENT_MOUSE_WHEEL:
-                selected += event.wheel.y;
-                if (selected < 0)
-                {
-                    selected = MODEL_COUNT - 1;
-                }
-                else if (selected >= MODEL_COUNT)
-                {
-                    selected = 0;
-                }
+            {
+                const int count = model_get_count();
+                const int next = selected + (int) event.wheel.y;
+                selected = (next % count + count) % count;
                 SDL_SetWindowTitle(window, model_get_str(selected));
                 break;
             }
+            }
         }
         {
             const bool* keys = SDL_GetKeyboardState(NULL);
@@ -104,8 +141,13 @@ int main(int argc, char** argv)
             float z1;
             float x2;
             float z2;
+            float polygon[CAMERA_MAX_POLYGON][2];
+            float sun[3];
             renderer_update(x, z);
             renderer_get_bounds(&x1, &z1, &x2, &z2);
+            renderer_get_sun(&sun[0], &sun[1], &sun[2]);
+            world_set_sun(sun[0], sun[1], sun[2]);
+            world_set_view(polygon, renderer_get_polygon(polygon));
             world_update(device, x1, z1, x2, z2);
         }
         renderer_draw();
@@ -155,7 +197,7 @@ int main(int argc, char** argv)
                 world_set_model(0, mx, mz);
             }
             const model_t picked = world_get_model(mx, mz);
-            if (picked != MODEL_COUNT)
+            if (picked != MODEL_NONE)
             {
                 mx *= MODEL_SIZE;
                 mz *= MODEL_SIZE;
@@ -163,14 +205,37 @@ int main(int argc, char** argv)
             }
         }
         renderer_blit();
+        /* pipelines and models arrive on their own threads while frames draw */
+        const double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+        if (first)
+        {
+            SDL_Log("Time to first frame: %.3f ms", ms);
+            first = false;
+        }
+        const renderer_state_t state = renderer_get_state();
+        if (state == RENDERER_STATE_FAILED)
+        {
+            SDL_Log("Failed to initialize renderer");
+            status = EXIT_FAILURE;
+            running = false;
+        }
+        else if (!loaded && state == RENDERER_STATE_LOADED && model_is_idle())
+        {
+            SDL_Log("Time to fully loaded: %.3f ms", ms);
+            loaded = true;
+        }
         database_set_state(selected, x, z);
+        database_update();
+        stats_update();
     }
     world_free(device);
     database_set_state(selected, x, z);
     database_free();
     renderer_free();
+    vfs_free();
+    pool_free();
     SDL_DestroyGPUDevice(device);
     SDL_DestroyWindow(window);
     SDL_Quit();
-    return EXIT_SUCCESS;
+    return status;
 }
\ No newline at end of file
@@ -1,40 +1,151 @@
 #include <SDL3/SDL.h>
 #include <stb_ds.h>
+#include <stb_image.h>
 #include <tinyobj_loader_c.h>
 #include <ctype.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include "config.h"
 #include "helpers.h"
 #include "model.h"
+#include "pool.h"
+#include "vfs.h"
 
-struct
+#define CACHE_MAGIC 0x4853454D
+#define CACHE_VERSION 5
+#define VERTEX_CACHE_SIZE 32
+#define FIFO_SIZE 16
+#define PALETTE_MASK ((1 << MODEL_NORMAL_SHIFT) - 1)
+#define NAME_SIZE 64
+#define PLACEHOLDER num_models
+
+/* palette layers are slots handed to resident meshes rather than one per
+model, the instances carry the layer so the count is only bound by the array
+layers every backend supports. the placeholder keeps the first */
+#define MAX_SLOTS 256
+
+typedef struct
+{
+    int16_t x;
+    int16_t y;
+    int16_t z;
+}
+position_t;
+
+typedef enum
+{
+    STATE_UNLOADED,
+    STATE_QUEUED,
+    STATE_LOADED,
+    STATE_FAILED,
+}
+state_t;
+
+/* decoded on the loader thread, uploaded on the main thread */
+typedef struct
+{
+    uint8_t palette[MODEL_PALETTE_SIZE * 4];
+    bool cached;
+    bool status;
+}
+load_t;
+
+/* chunks of a magicavoxel file that hold the first model and its palette */
+typedef struct
+{
+    const uint8_t* size;
+    const uint8_t* voxels;
+    const uint8_t* palette;
+    int num_voxels;
+}
+vox_t;
+
+/* followed by the vertices, the indices, the positions, their indices and
+the proxy vertices and indices. the stamp and size identify the source */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    int64_t stamp;
+    uint64_t size;
+    int32_t num_vertices;
+    int32_t num_indices;
+    int32_t num_positions;
+    int32_t num_position_indices;
+    int32_t num_proxy_vertices;
+    int32_t num_proxy_indices;
+    int32_t height;
+}
+header_t;
+
+typedef struct
 {
-    SDL_GPUBuffer* vbo;
-    SDL_GPUBuffer* ibo;
-    SDL_GPUTexture* palette;
+    void* cache;
+    size_t cache_size;
+    vertex_t* vertices;
+    uint32_t* indices;
+    float* positions;
+    uint32_t* position_indices;
+    vertex_t* proxy_vertices;
+    uint32_t* proxy_indices;
+    int num_vertices;
+    int num_positions;
+    int num_position_indices;
     int num_indices;
+    int num_proxy_vertices;
+    int num_proxy_indices;
+    int first_index;
+    int vertex_offset;
+    int first_proxy_index;
+    int proxy_vertex_offset;
     int height;
     int spread;
-    char str[256];
+    int passes;
+    bool is_slab;
+    model_slab_t slab;
+    char str[NAME_SIZE];
+    char mesh[NAME_SIZE];
+    char png[NAME_SIZE];
+    load_t load;
+    state_t state;
+    bool requested;
+    int source;
+    int users;
+    int slot;
 }
-static models[MODEL_COUNT];
+entry_t;
+
+/* registered models followed by the placeholder */
+static entry_t* models;
+static int num_models;
+static int max_spread;
+static model_t owners[MAX_SLOTS];
+static SDL_GPUTexture* palette;
+static SDL_GPUBuffer* vbo;
+static SDL_GPUBuffer* ibo;
+static SDL_GPUIndexElementSize index_size;
+static SDL_Thread* thread;
+static SDL_Mutex* mutex;
+static SDL_Condition* condition;
+static model_t* queue;
+static model_t* arrivals;
+static model_t* waiting;
+static int num_queued;
+static bool quit;
 
 typedef struct
 {
-    float vx;
-    float vy;
-    float vz;
-    float tx;
-    float ty;
-    float nx;
-    float ny;
-    float nz;
+    const void* data;
+    size_t size;
 }
-vertex_t;
+blob_t;
 
+/* the obj and its mtl are read through the vfs and kept mapped until the
+parse is done, tinyobj only reads them */
 static void func(
     void* ctx,
     const char* file,
@@ -43,32 +154,53 @@ static void func(
     char** data,
     size_t* size)
 {
+    assert(ctx);
     assert(file);
     assert(data);
     assert(size);
-    *data = SDL_LoadFile(file, size);
-    if (!data)
+    blob_t** blobs = ctx;
+    *data = (char*) vfs_map(file, size);
+    if (!*data)
     {
         SDL_Log("Failed to load model: %s", file);
+        *size = 0;
+        return;
     }
+    const blob_t blob = { *data, *size };
+    stbds_arrput(*blobs, blob);
 }
 
-static bool load(
+static int get_normal(
+    const float normal[3])
+{
+    int axis = 0;
+    for (int i = 1; i < 3; i++)
+    {
+        if (fabsf(normal[i]) > fabsf(normal[axis]))
+        {
+            axis = i;
+        }
+    }
+    return axis * 2 + (normal[axis] < 0.0f);
+}
+
+static bool load_obj(
     const model_t model,
-    const char* str,
-    SDL_GPUDevice* device,
-    SDL_GPUCopyPass* pass)
+    const char* obj)
 {
     bool status = true;
     tinyobj_attrib_t attrib = {0};
     tinyobj_shape_t* shapes = NULL;
     tinyobj_material_t* materials = NULL;
-    size_t num_shapes;
-    size_t num_materials;
-    char obj[256];
-    char png[256];
-    snprintf(obj, sizeof(obj), "%s.obj", str);
-    snprintf(png, sizeof(png), "%s.png", str);
+    size_t num_shapes = 0;
+    size_t num_materials = 0;
+    struct
+    {
+        vertex_t key;
+        int value;
+    }
+    *map = NULL;
+    blob_t* blobs = NULL;
     if (tinyobj_parse_obj(
         &attrib,
         &shapes,
@@ -77,48 +209,27 @@ static bool load(
         &num_materials,
         obj,
         func,
-        NULL,
+        &blobs,
         TINYOBJ_FLAG_TRIANGULATE) != TINYOBJ_SUCCESS)
     {
-        SDL_Log("Failed to parse model: %s", str);
+        SDL_Log("Failed to parse model: %s", obj);
         goto error;
     }
     models[model].height = 0;
     models[model].num_indices = attrib.num_faces;
-    models[model].palette = load_texture(device, png);
-    if (!models[model].palette)
-    {
-        SDL_Log("Failed to load palette: %s", str);
-        goto error;
-    }
-    struct
-    {
-        vertex_t key;
-        int value;
-    }
-    *map = NULL;
     stbds_hmdefault(map, -1);
     if (!map)
     {
-        SDL_Log("Failed to create map: %ss", str);
+        SDL_Log("Failed to create map: %ss", obj);
         goto error;
     }
-    SDL_GPUTransferBufferCreateInfo tbci = {0};
-    tbci.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
-    tbci.size = attrib.num_faces * sizeof(vertex_t);
-    SDL_GPUTransferBuffer* vbo = SDL_CreateGPUTransferBuffer(device, &tbci);
-    tbci.size = attrib.num_faces * sizeof(uint32_t);
-    SDL_GPUTransferBuffer* ibo = SDL_CreateGPUTransferBuffer(device, &tbci);
-    if (!vbo || !ibo)
-    {
-        SDL_Log("Failed to create transfer buffer(s): %s, %s", str, SDL_GetError());
-        goto error;
-    }
-    vertex_t* vertices = SDL_MapGPUTransferBuffer(device, vbo, false);
-    uint32_t* indices = SDL_MapGPUTransferBuffer(device, ibo, false);
+    vertex_t* vertices = malloc(attrib.num_faces * sizeof(vertex_t));
+    uint32_t* indices = malloc(attrib.num_faces * sizeof(uint32_t));
+    models[model].vertices = vertices;
+    models[model].indices = indices;
     if (!vertices || !indices)
     {
-        SDL_Log("Failed to map transfer buffer(s): %s, %s", str, SDL_GetError());
+        SDL_Log("Failed to allocate model data: %s", obj);
         goto error;
     }
     int num_vertices = 0;
@@ -127,22 +238,33 @@ static bool load(
         const tinyobj_vertex_index_t tvi = attrib.faces[i];
         if (tvi.v_idx < 0 || tvi.vn_idx < 0 || tvi.vt_idx < 0)
         {
-            SDL_Log("Missing model data: %s", str);
+            SDL_Log("Missing model data: %s", obj);
             goto error;
         }
+        /* exported voxels sit on a lattice of a tenth of a unit */
+        int16_t position[3];
+        for (int j = 0; j < 3; j++)
+        {
+            const float value = attrib.vertices[3 * tvi.v_idx + j] * 10.0f;
+            if (fabsf(value - roundf(value)) > 0.01f || fabsf(value) > INT16_MAX)
+            {
+                SDL_Log("Model is off the voxel lattice: %s", obj);
+                goto error;
+            }
+            position[j] = roundf(value);
+        }
+        const float u = attrib.texcoords[2 * tvi.vt_idx + 0] * MODEL_PALETTE_SIZE;
+        const int texel = clamp((int) u, 0, MODEL_PALETTE_SIZE - 1);
+        const int normal = get_normal(&attrib.normals[3 * tvi.vn_idx]);
         vertex_t vertex;
-        vertex.vx = attrib.vertices[3 * tvi.v_idx + 0] * 10.0f;
-        vertex.vy = attrib.vertices[3 * tvi.v_idx + 1] * 10.0f;
-        vertex.vz = attrib.vertices[3 * tvi.v_idx + 2] * 10.0f;
-        vertex.tx = attrib.texcoords[2 * tvi.vt_idx + 0];
-        vertex.ty = attrib.texcoords[2 * tvi.vt_idx + 1];
-        vertex.nx = attrib.normals[3 * tvi.vn_idx + 0];
-        vertex.ny = attrib.normals[3 * tvi.vn_idx + 1];
-        vertex.nz = attrib.normals[3 * tvi.vn_idx + 2];
+        vertex.x = position[0];
+        vertex.y = position[1];
+        vertex.z = position[2];
+        vertex.data = normal << MODEL_NORMAL_SHIFT | texel;
         const int index = stbds_hmget(map, vertex);
         if (index == -1)
         {
-            models[model].height = max(models[model].height, vertex.vy);
+            models[model].height = max(models[model].height, vertex.y);
             stbds_hmput(map, vertex, num_vertices);
             vertices[num_vertices] = vertex;
             indices[i] = num_vertices++;
@@ -152,30 +274,7 @@ static bool load(
             indices[i] = index;
         }
     }
-    SDL_UnmapGPUTransferBuffer(device, vbo);
-    SDL_UnmapGPUTransferBuffer(device, ibo);
-    SDL_GPUBufferCreateInfo bci = {0};
-    bci.usage = SDL_GPU_BUFFERUSAGE_VERTEX;
-    bci.size = num_vertices * sizeof(vertex_t);
-    models[model].vbo = SDL_CreateGPUBuffer(device, &bci);
-    bci.usage = SDL_GPU_BUFFERUSAGE_INDEX;
-    bci.size = models[model].num_indices * sizeof(uint32_t);
-    models[model].ibo = SDL_CreateGPUBuffer(device, &bci);
-    if (!models[model].vbo || !models[model].ibo)
-    {
-        SDL_Log("Failed to create model buffer(s): %s, %s", str, SDL_GetError());
-        goto error;
-    }
-    SDL_GPUTransferBufferLocation location = {0};
-    SDL_GPUBufferRegion region = {0};
-    location.transfer_buffer = vbo;
-    region.buffer = models[model].vbo;
-    region.size = num_vertices * sizeof(vertex_t);
-    SDL_UploadToGPUBuffer(pass, &location, &region, false);
-    location.transfer_buffer = ibo;
-    region.buffer = models[model].ibo;
-    region.size = models[model].num_indices * sizeof(uint32_t);
-    SDL_UploadToGPUBuffer(pass, &location, &region, false);
+    models[model].num_vertices = num_vertices;
     goto success;
 error:
     status = false;
@@ -183,136 +282,2019 @@ success:
     tinyobj_attrib_free(&attrib);
     tinyobj_shapes_free(shapes, num_shapes);
     tinyobj_materials_free(materials, num_materials);
+    for (int i = 0; i < stbds_arrlen(blobs); i++)
+    {
+        vfs_unmap(blobs[i].data, blobs[i].size);
+    }
+    stbds_arrfree(blobs);
     stbds_hmfree(map);
-    SDL_ReleaseGPUTransferBuffer(device, vbo);
-    SDL_ReleaseGPUTransferBuffer(device, ibo);
     return status;
 }
 
-bool model_init(
-    SDL_GPUDevice* device)
+static uint32_t read_uint32(
+    const uint8_t* data)
 {
-    assert(device);
-    SDL_GPUCommandBuffer* commands = SDL_AcquireGPUCommandBuffer(device);
-    if (!commands)
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return SDL_Swap32LE(value);
+}
+
+static bool parse_vox(
+    const uint8_t* data,
+    const size_t size,
+    vox_t* vox)
+{
+    /* a MAIN chunk followed by flat children: the model, the scene graph,
+    layers, materials and the palette. only the first model is used */
+    memset(vox, 0, sizeof(vox_t));
+    if (size < 20 || memcmp(data, "VOX ", 4) || memcmp(data + 8, "MAIN", 4))
     {
-        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
         return false;
     }
-    SDL_GPUCopyPass* pass = SDL_BeginGPUCopyPass(commands);
-    if (!pass)
+    uint64_t offset = 20 + (uint64_t) read_uint32(data + 12);
+    while (offset + 12 <= size)
     {
-        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
-        SDL_CancelGPUCommandBuffer(commands);
-        return false;
+        const uint8_t* chunk = data + offset;
+        const uint64_t content = read_uint32(chunk + 4);
+        const uint64_t children = read_uint32(chunk + 8);
+        if (offset + 12 + content > size)
+        {
+            return false;
+        }
+        if (!memcmp(chunk, "SIZE", 4) && !vox->size && content >= 12)
+        {
+            vox->size = chunk + 12;
+        }
+        else if (!memcmp(chunk, "XYZI", 4) && !vox->voxels && content >= 4)
+        {
+            vox->num_voxels = read_uint32(chunk + 12);
+            vox->voxels = chunk + 16;
+            if ((uint64_t) vox->num_voxels * 4 > content - 4)
+            {
+                return false;
+            }
+        }
+        else if (!memcmp(chunk, "RGBA", 4) && content >= MODEL_PALETTE_SIZE * 4)
+        {
+            vox->palette = chunk + 12;
+        }
+        offset += 12 + content + children;
     }
-    const char* names[MODEL_COUNT] =
+    return vox->size && vox->voxels && vox->palette;
+}
+
+static int get_voxel(
+    const int dims[3],
+    const int x,
+    const int y,
+    const int z)
+{
+    return (y * dims[2] + z) * dims[0] + x;
+}
+
+static int floor_div(
+    const int a,
+    const int b)
+{
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static bool mesh_voxels(
+    const uint8_t* colors,
+    const int dims[3],
+    const int origin[3],
+    const int scale,
+    vertex_t* vertices,
+    uint32_t* indices,
+    int* num_vertices,
+    int* num_indices)
+{
+    /* cull faces between filled voxels and merge the rest into greedy quads of
+    one palette entry each. the outputs must fit six faces per voxel */
+    struct
     {
-#define X(name, spread) #name,
-        MODELS
-#undef X
-    };
-    const int spreads[MODEL_COUNT] =
+        vertex_t key;
+        int value;
+    }
+    *map = NULL;
+    uint8_t* mask = malloc(256 * 256);
+    stbds_hmdefault(map, -1);
+    if (!mask || !map)
     {
-#define X(name, spread) spread,
-        MODELS
-#undef X
-    };
-    bool status = true;
-    for (model_t model = 0; model < MODEL_COUNT; model++)
+        free(mask);
+        stbds_hmfree(map);
+        return false;
+    }
+    *num_vertices = 0;
+    *num_indices = 0;
+    for (int axis = 0; axis < 3; axis++)
     {
-        const char* src = names[model];
-        char* dst = models[model].str;
-        for (int i = 0; i < 256 && src[i]; i++)
+        /* u and v are cyclic after the axis so u cross v points along it */
+        const int u = (axis + 1) % 3;
+        const int v = (axis + 2) % 3;
+        for (int sign = -1; sign <= 1; sign += 2)
         {
-            dst[i] = tolower(src[i]);
+            for (int d = 0; d < dims[axis]; d++)
+            {
+                /* faces of this slice not covered by a neighbour */
+                for (int j = 0; j < dims[v]; j++)
+                {
+                    for (int i = 0; i < dims[u]; i++)
+                    {
+                        int p[3];
+                        p[axis] = d;
+                        p[u] = i;
+                        p[v] = j;
+                        const uint8_t color = colors[get_voxel(dims, p[0], p[1], p[2])];
+                        p[axis] += sign;
+                        uint8_t neighbour = 0;
+                        if (p[axis] >= 0 && p[axis] < dims[axis])
+                        {
+                            neighbour = colors[get_voxel(dims, p[0], p[1], p[2])];
+                        }
+                        mask[j * dims[u] + i] = neighbour ? 0 : color;
+                    }
+                }
+                for (int j = 0; j < dims[v]; j++)
+                {
+                    for (int i = 0; i < dims[u]; i++)
+                    {
+                        const uint8_t color = mask[j * dims[u] + i];
+                        if (!color)
+                        {
+                            continue;
+                        }
+                        int w = 1;
+                        while (i + w < dims[u] && mask[j * dims[u] + i + w] == color)
+                        {
+                            w++;
+                        }
+                        int h = 1;
+                        for (; j + h < dims[v]; h++)
+                        {
+                            int k = 0;
+                            while (k < w && mask[(j + h) * dims[u] + i + k] == color)
+                            {
+                                k++;
+                            }
+                            if (k < w)
+                            {
+                                break;
+                            }
+                        }
+                        for (int row = 0; row < h; row++)
+                        {
+                            memset(&mask[(j + row) * dims[u] + i], 0, w);
+                        }
+                        int p[3];
+                        int a[3] = {0};
+                        int b[3] = {0};
+                        p[axis] = d + (sign > 0);
+                        p[u] = i;
+                        p[v] = j;
+                        a[sign > 0 ? u : v] = sign > 0 ? w : h;
+                        b[sign > 0 ? v : u] = sign > 0 ? h : w;
+                        int quad[4];
+                        for (int k = 0; k < 4; k++)
+                        {
+                            const int s = k == 1 || k == 2;
+                            const int t = k >= 2;
+                            vertex_t vertex;
+                            vertex.x = (p[0] + a[0] * s + b[0] * t) * scale + origin[0];
+                            vertex.y = (p[1] + a[1] * s + b[1] * t) * scale + origin[1];
+                            vertex.z = (p[2] + a[2] * s + b[2] * t) * scale + origin[2];
+                            vertex.data = (axis * 2 + (sign < 0)) << MODEL_NORMAL_SHIFT | (color - 1);
+                            quad[k] = stbds_hmget(map, vertex);
+                            if (quad[k] == -1)
+                            {
+                                stbds_hmput(map, vertex, *num_vertices);
+                                vertices[*num_vertices] = vertex;
+                                quad[k] = (*num_vertices)++;
+                            }
+                        }
+                        const int offsets[6] = { 0, 1, 2, 0, 2, 3 };
+                        for (int k = 0; k < 6; k++)
+                        {
+                            indices[(*num_indices)++] = quad[offsets[k]];
+                        }
+                    }
+                }
+            }
         }
-        models[model].spread = spreads[model];
-        if (!load(model, dst, device, pass))
+    }
+    free(mask);
+    stbds_hmfree(map);
+    return true;
+}
+
+static uint8_t* voxelize(
+    const vertex_t* vertices,
+    const uint32_t* indices,
+    const int num_indices,
+    const int scale,
+    int dims[3],
+    int origin[3])
+{
+    /* fill the unit cells between each bottom and top face of a closed mesh,
+    then mark every cell of a grid scale times coarser that one falls in */
+    int lo[3] = { INT16_MAX, INT16_MAX, INT16_MAX };
+    int hi[3] = { INT16_MIN, INT16_MIN, INT16_MIN };
+    for (int i = 0; i < num_indices; i++)
+    {
+        const vertex_t* vertex = &vertices[indices[i]];
+        const int position[3] = { vertex->x, vertex->y, vertex->z };
+        for (int j = 0; j < 3; j++)
         {
-            SDL_Log("Failed to load model: %s", dst);
-            status = false;
-            break;
+            lo[j] = min(lo[j], position[j]);
+            hi[j] = max(hi[j], position[j]);
         }
     }
-    SDL_EndGPUCopyPass(pass);
-    SDL_SubmitGPUCommandBuffer(commands);
-    if (!status)
+    int size[3];
+    for (int i = 0; i < 3; i++)
     {
-        model_free(device);
+        size[i] = hi[i] - lo[i];
+        if (size[i] <= 0 || size[i] > 256)
+        {
+            return NULL;
+        }
+        origin[i] = floor_div(lo[i], scale) * scale;
+        dims[i] = (hi[i] - origin[i] + scale - 1) / scale;
     }
-    return status;
-}
-
-void  model_free(
-    SDL_GPUDevice* device)
-{
-    assert(device);
-    for (model_t model = 0; model < MODEL_COUNT; model++)
+    int* deltas = calloc(size[0] * (size[1] + 1) * size[2], sizeof(int));
+    uint8_t* colors = calloc(dims[0] * dims[1] * dims[2], 1);
+    if (!deltas || !colors)
+    {
+        free(deltas);
+        free(colors);
+        return NULL;
+    }
+    for (int i = 0; i < num_indices; i += 3)
     {
-        if (models[model].vbo)
+        const vertex_t* a = &vertices[indices[i + 0]];
+        const vertex_t* b = &vertices[indices[i + 1]];
+        const vertex_t* c = &vertices[indices[i + 2]];
+        const int normal = a->data >> MODEL_NORMAL_SHIFT;
+        if (normal != MODEL_NORMAL_POSITIVE_Y && normal != MODEL_NORMAL_NEGATIVE_Y)
         {
-            SDL_ReleaseGPUBuffer(device, models[model].vbo);
-            models[model].vbo = NULL;
+            continue;
         }
-        if (models[model].ibo)
+        const int x1 = min(a->x, min(b->x, c->x));
+        const int z1 = min(a->z, min(b->z, c->z));
+        const int x2 = max(a->x, max(b->x, c->x));
+        const int z2 = max(a->z, max(b->z, c->z));
+        for (int z = z1; z < z2; z++)
         {
-            SDL_ReleaseGPUBuffer(device, models[model].ibo);
-            models[model].ibo = NULL;
+            for (int x = x1; x < x2; x++)
+            {
+                /* sample just off the centre so a cell on an edge shared by
+                two triangles lands in exactly one of them */
+                const double px = x + 0.5 + 1.0 / 1024.0;
+                const double pz = z + 0.5 + 1.0 / 1048576.0;
+                const double e1 = (b->x - a->x) * (pz - a->z) - (b->z - a->z) * (px - a->x);
+                const double e2 = (c->x - b->x) * (pz - b->z) - (c->z - b->z) * (px - b->x);
+                const double e3 = (a->x - c->x) * (pz - c->z) - (a->z - c->z) * (px - c->x);
+                if ((e1 > 0.0 && e2 > 0.0 && e3 > 0.0) || (e1 < 0.0 && e2 < 0.0 && e3 < 0.0))
+                {
+                    const int index = ((a->y - lo[1]) * size[2] + z - lo[2]) * size[0] + x - lo[0];
+                    deltas[index] += normal == MODEL_NORMAL_NEGATIVE_Y ? 1 : -1;
+                }
+            }
         }
-        if (models[model].palette)
+    }
+    for (int z = 0; z < size[2]; z++)
+    {
+        for (int x = 0; x < size[0]; x++)
         {
-            SDL_ReleaseGPUTexture(device, models[model].palette);
-            models[model].palette = NULL;
+            int count = 0;
+            for (int y = 0; y < size[1]; y++)
+            {
+                count += deltas[(y * size[2] + z) * size[0] + x];
+                if (count > 0)
+                {
+                    colors[get_voxel(dims,
+                        (x + lo[0] - origin[0]) / scale,
+                        (y + lo[1] - origin[1]) / scale,
+                        (z + lo[2] - origin[2]) / scale)] = 1;
+                }
+            }
         }
     }
+    free(deltas);
+    return colors;
 }
 
-SDL_GPUBuffer* model_get_vbo(
-    const model_t model)
+static bool contains(
+    const uint8_t* outer,
+    const int outer_dims[3],
+    const int outer_origin[3],
+    const uint8_t* inner,
+    const int inner_dims[3],
+    const int inner_origin[3])
 {
-    assert(model < MODEL_COUNT);
-    return models[model].vbo;
+    for (int y = 0; y < inner_dims[1]; y++)
+    {
+        for (int z = 0; z < inner_dims[2]; z++)
+        {
+            for (int x = 0; x < inner_dims[0]; x++)
+            {
+                if (!inner[get_voxel(inner_dims, x, y, z)])
+                {
+                    continue;
+                }
+                const int a = x + inner_origin[0] - outer_origin[0];
+                const int b = y + inner_origin[1] - outer_origin[1];
+                const int c = z + inner_origin[2] - outer_origin[2];
+                if (a < 0 || a >= outer_dims[0] ||
+                    b < 0 || b >= outer_dims[1] ||
+                    c < 0 || c >= outer_dims[2] ||
+                    !outer[get_voxel(outer_dims, a, b, c)])
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
 }
 
-SDL_GPUBuffer* model_get_ibo(
-    const model_t model)
+static bool load_vox(
+    const model_t model,
+    const vox_t* vox)
 {
-    assert(model < MODEL_COUNT);
-    return models[model].ibo;
+    /* magicavoxel is z up, so rotate into y up keeping the handedness and
+    center the footprint on the origin like the exported meshes */
+    bool status = true;
+    const int dims[3] =
+    {
+        read_uint32(vox->size + 0),
+        read_uint32(vox->size + 8),
+        read_uint32(vox->size + 4),
+    };
+    if (dims[0] <= 0 || dims[1] <= 0 || dims[2] <= 0 ||
+        dims[0] > 256 || dims[1] > 256 || dims[2] > 256)
+    {
+        SDL_Log("Bad model size: %s", models[model].str);
+        return false;
+    }
+    const int origin[3] = { -dims[0] / 2, 0, -dims[2] / 2 };
+    uint8_t* colors = calloc(dims[0] * dims[1] * dims[2], 1);
+    const int max_quads = vox->num_voxels * 6;
+    vertex_t* vertices = malloc(max_quads * 4 * sizeof(vertex_t));
+    uint32_t* indices = malloc(max_quads * 6 * sizeof(uint32_t));
+    models[model].vertices = vertices;
+    models[model].indices = indices;
+    if (!colors || !vertices || !indices)
+    {
+        SDL_Log("Failed to allocate model data: %s", models[model].str);
+        goto error;
+    }
+    for (int i = 0; i < vox->num_voxels; i++)
+    {
+        const uint8_t* voxel = vox->voxels + i * 4;
+        const int x = voxel[0];
+        const int y = voxel[2];
+        const int z = dims[2] - 1 - voxel[1];
+        if (x >= dims[0] || y >= dims[1] || z < 0)
+        {
+            SDL_Log("Voxel out of bounds: %s", models[model].str);
+            goto error;
+        }
+        colors[get_voxel(dims, x, y, z)] = voxel[3];
+    }
+    if (!mesh_voxels(
+        colors,
+        dims,
+        origin,
+        1,
+        vertices,
+        indices,
+        &models[model].num_vertices,
+        &models[model].num_indices))
+    {
+        SDL_Log("Failed to mesh model: %s", models[model].str);
+        goto error;
+    }
+    models[model].height = 0;
+    for (int i = 0; i < models[model].num_vertices; i++)
+    {
+        models[model].height = max(models[model].height, vertices[i].y);
+    }
+    goto success;
+error:
+    status = false;
+success:
+    free(colors);
+    return status;
 }
 
-SDL_GPUTexture* model_get_palette(
+static bool load_proxy(
     const model_t model)
 {
-    assert(model < MODEL_COUNT);
-    return models[model].palette;
+    /* the ray and sun passes only need the volume so they draw a coarser voxel
+    hull instead. it contains every voxel of the model so shadows only grow */
+    bool status = true;
+    models[model].num_proxy_vertices = 0;
+    models[model].num_proxy_indices = 0;
+    if (MODEL_PROXY_SCALE < 2 || !(models[model].passes & (MODEL_PASS_RAY | MODEL_PASS_SUN)))
+    {
+        return true;
+    }
+    int dims[3];
+    int origin[3];
+    int fine_dims[3];
+    int fine_origin[3];
+    int proxy_dims[3];
+    int proxy_origin[3];
+    uint8_t* proxy = NULL;
+    uint8_t* colors = voxelize(
+        models[model].vertices,
+        models[model].indices,
+        models[model].num_indices,
+        MODEL_PROXY_SCALE,
+        dims,
+        origin);
+    uint8_t* fine = voxelize(
+        models[model].vertices,
+        models[model].indices,
+        models[model].num_indices,
+        1,
+        fine_dims,
+        fine_origin);
+    if (!colors || !fine)
+    {
+        SDL_Log("Failed to voxelize model: %s", models[model].str);
+        goto error;
+    }
+    const int max_quads = dims[0] * dims[1] * dims[2] * 6;
+    models[model].proxy_vertices = malloc(max_quads * 4 * sizeof(vertex_t));
+    models[model].proxy_indices = malloc(max_quads * 6 * sizeof(uint32_t));
+    if (!models[model].proxy_vertices || !models[model].proxy_indices || !mesh_voxels(
+        colors,
+        dims,
+        origin,
+        MODEL_PROXY_SCALE,
+        models[model].proxy_vertices,
+        models[model].proxy_indices,
+        &models[model].num_proxy_vertices,
+        &models[model].num_proxy_indices))
+    {
+        SDL_Log("Failed to mesh proxy: %s", models[model].str);
+        goto error;
+    }
+    /* voxelize the hull back to check it covers the model */
+    proxy = voxelize(
+        models[model].proxy_vertices,
+        models[model].proxy_indices,
+        models[model].num_proxy_indices,
+        1,
+        proxy_dims,
+        proxy_origin);
+    const bool conservative = proxy && contains(proxy, proxy_dims, proxy_origin, fine, fine_dims, fine_origin);
+    if (!conservative)
+    {
+        SDL_Log("Proxy doesn't cover model: %s", models[model].str);
+    }
+    SDL_Log("Built proxy: %s, %d -> %d triangles",
+        models[model].str,
+        models[model].num_indices / 3,
+        models[model].num_proxy_indices / 3);
+    if (!conservative || models[model].num_proxy_indices >= models[model].num_indices)
+    {
+        models[model].num_proxy_vertices = 0;
+        models[model].num_proxy_indices = 0;
+    }
+    goto success;
+error:
+    status = false;
+success:
+    free(colors);
+    free(fine);
+    free(proxy);
+    return status;
 }
 
-int model_get_num_indices(
-    const model_t model)
+static float get_acmr(
+    const uint32_t* indices,
+    const int num_indices,
+    const int num_vertices)
+{
+    /* average cache misses per triangle against a small fifo, the model most
+    hardware is closest to */
+    int* stamps = malloc(num_vertices * sizeof(int));
+    if (!stamps)
+    {
+        return 0.0f;
+    }
+    for (int i = 0; i < num_vertices; i++)
+    {
+        stamps[i] = -FIFO_SIZE;
+    }
+    int misses = 0;
+    for (int i = 0; i < num_indices; i++)
+    {
+        if (misses - stamps[indices[i]] >= FIFO_SIZE)
+        {
+            stamps[indices[i]] = misses++;
+        }
+    }
+    free(stamps);
+    return misses * 3.0f / num_indices;
+}
+
+static float get_score(
+    const int position,
+    const int valence)
 {
-    assert(model < MODEL_COUNT);
-    return models[model].num_indices;
+    /* forsyth: the last triangle is fresh in the cache, older entries decay
+    and vertices with few triangles left are finished off early */
+    if (!valence)
+    {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (position >= 3)
+    {
+        score = powf(1.0f - (position - 3) / (float) (VERTEX_CACHE_SIZE - 3), 1.5f);
+    }
+    else if (position >= 0)
+    {
+        score = 0.75f;
+    }
+    return score + 2.0f / sqrtf(valence);
 }
 
-int model_get_height(
+static bool optimize(
     const model_t model)
 {
-    assert(model < MODEL_COUNT);
-    return models[model].height;
+    /* reorder triangles for the post transform cache, then renumber vertices
+    in first use order so fetches walk the vertex buffer forwards */
+    bool status = true;
+    const int num_vertices = models[model].num_vertices;
+    const int num_indices = models[model].num_indices;
+    const int num_triangles = num_indices / 3;
+    uint32_t* indices = models[model].indices;
+    int* valences = calloc(num_vertices, sizeof(int));
+    int* offsets = calloc(num_vertices + 1, sizeof(int));
+    int* triangles = malloc(num_indices * sizeof(int));
+    int* positions = malloc(num_vertices * sizeof(int));
+    float* scores = malloc(num_vertices * sizeof(float));
+    float* triangle_scores = malloc(num_triangles * sizeof(float));
+    bool* emitted = calloc(num_triangles, sizeof(bool));
+    uint32_t* output = malloc(num_indices * sizeof(uint32_t));
+    int* remap = malloc(num_vertices * sizeof(int));
+    vertex_t* vertices = malloc(num_vertices * sizeof(vertex_t));
+    if (!valences || !offsets || !triangles || !positions || !scores ||
+        !triangle_scores || !emitted || !output || !remap || !vertices)
+    {
+        SDL_Log("Failed to allocate optimizer: %s", models[model].str);
+        goto error;
+    }
+    const float before = get_acmr(indices, num_indices, num_vertices);
+    for (int i = 0; i < num_indices; i++)
+    {
+        offsets[indices[i] + 1]++;
+    }
+    for (int i = 0; i < num_vertices; i++)
+    {
+        offsets[i + 1] += offsets[i];
+    }
+    for (int i = 0; i < num_indices; i++)
+    {
+        triangles[offsets[indices[i]] + valences[indices[i]]++] = i / 3;
+    }
+    for (int i = 0; i < num_vertices; i++)
+    {
+        positions[i] = -1;
+        scores[i] = get_score(-1, valences[i]);
+    }
+    for (int i = 0; i < num_triangles; i++)
+    {
+        triangle_scores[i] = 0.0f;
+        for (int j = 0; j < 3; j++)
+        {
+            triangle_scores[i] += scores[indices[i * 3 + j]];
+        }
+    }
+    int cache[VERTEX_CACHE_SIZE + 3];
+    int cache_size = 0;
+    int best = -1;
+    for (int i = 0; i < num_triangles; i++)
+    {
+        if (best == -1)
+        {
+            /* nothing adjacent to the cache is left, so start a new island */
+            for (int j = 0; j < num_triangles; j++)
+            {
+                if (!emitted[j] && (best == -1 || triangle_scores[j] > triangle_scores[best]))
+                {
+                    best = j;
+                }
+            }
+        }
+        emitted[best] = true;
+        int next[VERTEX_CACHE_SIZE + 3];
+        int next_size = 0;
+        for (int j = 0; j < 3; j++)
+        {
+            const int vertex = indices[best * 3 + j];
+            output[i * 3 + j] = vertex;
+            int* adjacent = &triangles[offsets[vertex]];
+            for (int k = 0; k < valences[vertex]; k++)
+            {
+                if (adjacent[k] == best)
+                {
+                    adjacent[k] = adjacent[--valences[vertex]];
+                    break;
+                }
+            }
+            next[next_size++] = vertex;
+        }
+        for (int j = 0; j < cache_size; j++)
+        {
+            const int vertex = cache[j];
+            if (vertex != next[0] && vertex != next[1] && vertex != next[2])
+            {
+                next[next_size++] = vertex;
+            }
+        }
+        best = -1;
+        for (int j = 0; j < next_size; j++)
+        {
+            const int vertex = next[j];
+            positions[vertex] = j < VERTEX_CACHE_SIZE ? j : -1;
+            const float score = get_score(positions[vertex], valences[vertex]);
+            const float delta = score - scores[vertex];
+            scores[vertex] = score;
+            for (int k = 0; k < valences[vertex]; k++)
+            {
+                const int triangle = triangles[offsets[vertex] + k];
+                triangle_scores[triangle] += delta;
+                if (best == -1 || triangle_scores[triangle] > triangle_scores[best])
+                {
+                    best = triangle;
+                }
+            }
+        }
+        cache_size = min(next_size, VERTEX_CACHE_SIZE);
+        memcpy(cache, next, cache_size * sizeof(int));
+    }
+    /* exported quads often come in a good order already, so keep it unless
+    the reorder is a measurable win */
+    float after = get_acmr(output, num_indices, num_vertices);
+    if (after >= before)
+    {
+        memcpy(output, indices, num_indices * sizeof(uint32_t));
+        after = before;
+    }
+    for (int i = 0; i < num_vertices; i++)
+    {
+        remap[i] = -1;
+    }
+    int num_remapped = 0;
+    for (int i = 0; i < num_indices; i++)
+    {
+        if (remap[output[i]] == -1)
+        {
+            vertices[num_remapped] = models[model].vertices[output[i]];
+            remap[output[i]] = num_remapped++;
+        }
+        indices[i] = remap[output[i]];
+    }
+    memcpy(models[model].vertices, vertices, num_remapped * sizeof(vertex_t));
+    models[model].num_vertices = num_remapped;
+    const int stride = num_remapped > UINT16_MAX ? sizeof(uint32_t) : sizeof(uint16_t);
+    SDL_Log("Optimized model: %s, %d triangles, acmr %.3f -> %.3f, %d -> %d index bytes",
+        models[model].str,
+        num_triangles,
+        before,
+        after,
+        num_indices * (int) sizeof(uint32_t),
+        num_indices * stride);
+    goto success;
+error:
+    status = false;
+success:
+    free(valences);
+    free(offsets);
+    free(triangles);
+    free(positions);
+    free(scores);
+    free(triangle_scores);
+    free(emitted);
+    free(output);
+    free(remap);
+    free(vertices);
+    return status;
 }
 
-int model_get_spread(
+static bool load_positions(
     const model_t model)
 {
-    assert(model < MODEL_COUNT);
-    return models[model].spread;
+    /* batched occluders only need positions, so the copies of a corner made
+    for each normal and palette entry collapse into one. batches are only
+    drawn in the ray and sun passes so they come from the proxy if any */
+    struct
+    {
+        position_t key;
+        int value;
+    }
+    *map = NULL;
+    const bool proxy = models[model].num_proxy_indices > 0;
+    const vertex_t* vertices = proxy ? models[model].proxy_vertices : models[model].vertices;
+    const uint32_t* indices = proxy ? models[model].proxy_indices : models[model].indices;
+    const int num_vertices = proxy ? models[model].num_proxy_vertices : models[model].num_vertices;
+    const int num_indices = proxy ? models[model].num_proxy_indices : models[model].num_indices;
+    models[model].positions = malloc(num_vertices * sizeof(float) * 3);
+    models[model].position_indices = malloc(num_indices * sizeof(uint32_t));
+    if (!models[model].positions || !models[model].position_indices)
+    {
+        SDL_Log("Failed to allocate positions: %s", models[model].str);
+        free(models[model].positions);
+        free(models[model].position_indices);
+        models[model].positions = NULL;
+        models[model].position_indices = NULL;
+        return false;
+    }
+    stbds_hmdefault(map, -1);
+    if (!map)
+    {
+        SDL_Log("Failed to create map: %s", models[model].str);
+        free(models[model].positions);
+        free(models[model].position_indices);
+        models[model].positions = NULL;
+        models[model].position_indices = NULL;
+        return false;
+    }
+    int num_positions = 0;
+    for (int i = 0; i < num_indices; i++)
+    {
+        const vertex_t* vertex = &vertices[indices[i]];
+        const position_t key = { vertex->x, vertex->y, vertex->z };
+        int index = stbds_hmget(map, key);
+        if (index == -1)
+        {
+            index = num_positions++;
+            stbds_hmput(map, key, index);
+            models[model].positions[index * 3 + 0] = vertex->x;
+            models[model].positions[index * 3 + 1] = vertex->y;
+            models[model].positions[index * 3 + 2] = vertex->z;
+        }
+        models[model].position_indices[i] = index;
+    }
+    models[model].num_positions = num_positions;
+    models[model].num_position_indices = num_indices;
+    stbds_hmfree(map);
+    return true;
+}
+
+/* the cache is only valid for the exact source it was built from and is
+keyed by it, so models sharing a mesh share its cache */
+static bool load_cache(
+    const model_t model,
+    const char* source)
+{
+    char mesh[256];
+    snprintf(mesh, sizeof(mesh), "%s.mesh", source);
+    vfs_info_t info;
+    if (!vfs_get_info(source, &info))
+    {
+        return false;
+    }
+    size_t size;
+    uint8_t* data = map_file(mesh, &size);
+    if (!data)
+    {
+        return false;
+    }
+    const header_t* header = (const header_t*) data;
+    if (size < sizeof(header_t) ||
+        header->magic != CACHE_MAGIC ||
+        header->version != CACHE_VERSION ||
+        header->stamp != info.stamp ||
+        header->size != info.size ||
+        size != sizeof(header_t) +
+            (uint64_t) header->num_vertices * sizeof(vertex_t) +
+            (uint64_t) header->num_indices * sizeof(uint32_t) +
+            (uint64_t) header->num_positions * sizeof(float) * 3 +
+            (uint64_t) header->num_position_indices * sizeof(uint32_t) +
+            (uint64_t) header->num_proxy_vertices * sizeof(vertex_t) +
+            (uint64_t) header->num_proxy_indices * sizeof(uint32_t))
+    {
+        SDL_Log("Rebuilding model cache: %s", mesh);
+        unmap_file(data, size);
+        return false;
+    }
+    const int num_vertices = header->num_vertices;
+    const int num_indices = header->num_indices;
+    const int num_positions = header->num_positions;
+    const int num_position_indices = header->num_position_indices;
+    const uint8_t* vertices = data + sizeof(header_t);
+    const uint8_t* indices = vertices + num_vertices * sizeof(vertex_t);
+    const uint8_t* positions = indices + num_indices * sizeof(uint32_t);
+    const uint8_t* position_indices = positions + num_positions * sizeof(float) * 3;
+    const uint8_t* proxy_vertices = position_indices + num_position_indices * sizeof(uint32_t);
+    const uint8_t* proxy_indices = proxy_vertices + header->num_proxy_vertices * sizeof(vertex_t);
+    models[model].positions = malloc(num_positions * sizeof(float) * 3);
+    models[model].position_indices = malloc(num_position_indices * sizeof(uint32_t));
+    if (!models[model].positions || !models[model].position_indices)
+    {
+        SDL_Log("Failed to allocate positions: %s", source);
+        free(models[model].positions);
+        free(models[model].position_indices);
+        models[model].positions = NULL;
+        models[model].position_indices = NULL;
+        unmap_file(data, size);
+        return false;
+    }
+    memcpy(models[model].positions, positions, num_positions * sizeof(float) * 3);
+    memcpy(models[model].position_indices, position_indices, num_position_indices * sizeof(uint32_t));
+    /* the meshes are copied straight from the mapping at upload */
+    models[model].vertices = (vertex_t*) vertices;
+    models[model].indices = (uint32_t*) indices;
+    models[model].proxy_vertices = (vertex_t*) proxy_vertices;
+    models[model].proxy_indices = (uint32_t*) proxy_indices;
+    models[model].num_vertices = num_vertices;
+    models[model].num_indices = num_indices;
+    models[model].num_positions = num_positions;
+    models[model].num_position_indices = num_position_indices;
+    models[model].num_proxy_vertices = header->num_proxy_vertices;
+    models[model].num_proxy_indices = header->num_proxy_indices;
+    models[model].height = header->height;
+    models[model].cache = data;
+    models[model].cache_size = size;
+    return true;
+}
+
+static void save_cache(
+    const model_t model,
+    const char* source)
+{
+    char mesh[256];
+    char tmp[256];
+    snprintf(mesh, sizeof(mesh), "%s.mesh", source);
+    snprintf(tmp, sizeof(tmp), "%s.mesh.tmp", source);
+    vfs_info_t info;
+    if (!vfs_get_info(source, &info))
+    {
+        SDL_Log("Failed to get path info: %s, %s", source, SDL_GetError());
+        return;
+    }
+    header_t header = {0};
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.stamp = info.stamp;
+    header.size = info.size;
+    header.num_vertices = models[model].num_vertices;
+    header.num_indices = models[model].num_indices;
+    header.num_positions = models[model].num_positions;
+    header.num_position_indices = models[model].num_position_indices;
+    header.num_proxy_vertices = models[model].num_proxy_vertices;
+    header.num_proxy_indices = models[model].num_proxy_indices;
+    header.height = models[model].height;
+    const void* data[7] =
+    {
+        &header,
+        models[model].vertices,
+        models[model].indices,
+        models[model].positions,
+        models[model].position_indices,
+        models[model].proxy_vertices,
+        models[model].proxy_indices,
+    };
+    const size_t sizes[7] =
+    {
+        sizeof(header_t),
+        header.num_vertices * sizeof(vertex_t),
+        header.num_indices * sizeof(uint32_t),
+        header.num_positions * sizeof(float) * 3,
+        header.num_position_indices * sizeof(uint32_t),
+        header.num_proxy_vertices * sizeof(vertex_t),
+        header.num_proxy_indices * sizeof(uint32_t),
+    };
+    /* written aside and renamed so a partial file is never picked up */
+    SDL_IOStream* stream = SDL_IOFromFile(tmp, "wb");
+    if (!stream)
+    {
+        SDL_Log("Failed to open model cache: %s, %s", tmp, SDL_GetError());
+        return;
+    }
+    bool status = true;
+    for (int i = 0; i < 7 && status; i++)
+    {
+        status = SDL_WriteIO(stream, data[i], sizes[i]) == sizes[i];
+    }
+    status = SDL_CloseIO(stream) && status;
+    if (!status || !SDL_RenamePath(tmp, mesh))
+    {
+        SDL_Log("Failed to write model cache: %s, %s", mesh, SDL_GetError());
+        SDL_RemovePath(tmp);
+    }
+}
+
+static void load_slab(
+    const model_t model)
+{
+    /* every corner must sit on the tile footprint, the top must use a single
+    palette entry and the +x side gives the bands the other sides repeat */
+    model_slab_t* slab = &models[model].slab;
+    const vertex_t* vertices = models[model].vertices;
+    const uint32_t* indices = models[model].indices;
+    const int size = MODEL_SIZE / 2;
+    bool has_top = false;
+    int num_heights = 0;
+    models[model].is_slab = false;
+    memset(slab, 0, sizeof(model_slab_t));
+    for (int i = 0; i < models[model].num_vertices; i++)
+    {
+        const vertex_t* vertex = &vertices[i];
+        const int normal = vertex->data >> MODEL_NORMAL_SHIFT;
+        const int palette = vertex->data & PALETTE_MASK;
+        if (abs(vertex->x) != size || abs(vertex->z) != size)
+        {
+            return;
+        }
+        if (normal == MODEL_NORMAL_POSITIVE_Y)
+        {
+            if (has_top && slab->top != palette)
+            {
+                return;
+            }
+            slab->top = palette;
+            has_top = true;
+        }
+        if (normal != MODEL_NORMAL_POSITIVE_X)
+        {
+            continue;
+        }
+        const int height = vertex->y;
+        int j = 0;
+        while (j < num_heights && slab->heights[j] < height)
+        {
+            j++;
+        }
+        if (j < num_heights && slab->heights[j] == height)
+        {
+            continue;
+        }
+        if (num_heights == MODEL_MAX_BANDS + 1)
+        {
+            return;
+        }
+        memmove(&slab->heights[j + 1], &slab->heights[j], (num_heights - j) * sizeof(int));
+        slab->heights[j] = height;
+        num_heights++;
+    }
+    if (!has_top || num_heights < 2 || slab->heights[0] != 0 ||
+        slab->heights[num_heights - 1] != models[model].height)
+    {
+        return;
+    }
+    slab->num_bands = num_heights - 1;
+    bool found[MODEL_MAX_BANDS] = {0};
+    for (int i = 0; i < models[model].num_indices; i += 3)
+    {
+        const vertex_t* a = &vertices[indices[i + 0]];
+        const vertex_t* b = &vertices[indices[i + 1]];
+        const vertex_t* c = &vertices[indices[i + 2]];
+        if (a->data >> MODEL_NORMAL_SHIFT != MODEL_NORMAL_POSITIVE_X)
+        {
+            continue;
+        }
+        if (a->data != b->data || a->data != c->data)
+        {
+            return;
+        }
+        const int y1 = min(a->y, min(b->y, c->y));
+        const int y2 = max(a->y, max(b->y, c->y));
+        for (int j = 0; j < slab->num_bands; j++)
+        {
+            if (slab->heights[j] >= y1 && slab->heights[j + 1] <= y2)
+            {
+                slab->palettes[j] = a->data & PALETTE_MASK;
+                found[j] = true;
+            }
+        }
+    }
+    for (int i = 0; i < slab->num_bands; i++)
+    {
+        if (!found[i])
+        {
+            return;
+        }
+    }
+    models[model].is_slab = true;
+}
+
+static void set_slot(
+    const model_t model,
+    const int slot)
+{
+    models[model].slot = slot;
+    if (slot)
+    {
+        owners[slot] = model;
+    }
+}
+
+static void copy_mesh(
+    vertex_t* dst_vertices,
+    uint8_t* dst_indices,
+    const vertex_t* vertices,
+    const uint32_t* indices,
+    const int num_vertices,
+    const int num_indices)
+{
+    memcpy(dst_vertices, vertices, num_vertices * sizeof(vertex_t));
+    if (index_size == SDL_GPU_INDEXELEMENTSIZE_32BIT)
+    {
+        memcpy(dst_indices, indices, num_indices * sizeof(uint32_t));
+        return;
+    }
+    uint16_t* data = (uint16_t*) dst_indices;
+    for (int i = 0; i < num_indices; i++)
+    {
+        data[i] = indices[i];
+    }
+}
+
+static int get_owner(
+    const int slot)
+{
+    return slot ? owners[slot] : PLACEHOLDER;
+}
+
+static SDL_GPUIndexElementSize layout(
+    int* num_vertices,
+    int* num_indices)
+{
+    /* the placeholder and every resident mesh and proxy are suballocated from
+    one vertex and one index buffer, rebuilt whenever a model arrives. indices
+    are relative to each mesh so 16 bits cover any sane model */
+    SDL_GPUIndexElementSize size = SDL_GPU_INDEXELEMENTSIZE_16BIT;
+    *num_vertices = 0;
+    *num_indices = 0;
+    for (int slot = 0; slot < MAX_SLOTS; slot++)
+    {
+        const int model = get_owner(slot);
+        if (model == MODEL_NONE)
+        {
+            continue;
+        }
+        models[model].vertex_offset = *num_vertices;
+        models[model].first_index = *num_indices;
+        *num_vertices += models[model].num_vertices;
+        *num_indices += models[model].num_indices;
+        models[model].proxy_vertex_offset = *num_vertices;
+        models[model].first_proxy_index = *num_indices;
+        *num_vertices += models[model].num_proxy_vertices;
+        *num_indices += models[model].num_proxy_indices;
+        if (models[model].num_vertices > UINT16_MAX || models[model].num_proxy_vertices > UINT16_MAX)
+        {
+            size = SDL_GPU_INDEXELEMENTSIZE_32BIT;
+        }
+    }
+    return size;
+}
+
+static bool upload(
+    SDL_GPUDevice* device,
+    SDL_GPUCopyPass* pass)
+{
+    int num_vertices;
+    int num_indices;
+    const SDL_GPUIndexElementSize size = layout(&num_vertices, &num_indices);
+    const int stride = size == SDL_GPU_INDEXELEMENTSIZE_16BIT ? sizeof(uint16_t) : sizeof(uint32_t);
+    SDL_GPUTransferBufferCreateInfo tbci = {0};
+    tbci.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+    tbci.size = num_vertices * sizeof(vertex_t);
+    SDL_GPUTransferBuffer* vtbo = SDL_CreateGPUTransferBuffer(device, &tbci);
+    tbci.size = num_indices * stride;
+    SDL_GPUTransferBuffer* itbo = SDL_CreateGPUTransferBuffer(device, &tbci);
+    SDL_GPUBufferCreateInfo bci = {0};
+    bci.usage = SDL_GPU_BUFFERUSAGE_VERTEX;
+    bci.size = num_vertices * sizeof(vertex_t);
+    SDL_GPUBuffer* next_vbo = SDL_CreateGPUBuffer(device, &bci);
+    bci.usage = SDL_GPU_BUFFERUSAGE_INDEX;
+    bci.size = num_indices * stride;
+    SDL_GPUBuffer* next_ibo = SDL_CreateGPUBuffer(device, &bci);
+    vertex_t* vertices = NULL;
+    uint8_t* indices = NULL;
+    if (!vtbo || !itbo || !next_vbo || !next_ibo)
+    {
+        SDL_Log("Failed to create buffer(s): %s", SDL_GetError());
+        goto error;
+    }
+    vertices = SDL_MapGPUTransferBuffer(device, vtbo, false);
+    indices = SDL_MapGPUTransferBuffer(device, itbo, false);
+    if (!vertices || !indices)
+    {
+        SDL_Log("Failed to map transfer buffer(s): %s", SDL_GetError());
+        goto error;
+    }
+    index_size = size;
+    for (int slot = 0; slot < MAX_SLOTS; slot++)
+    {
+        const int model = get_owner(slot);
+        if (model == MODEL_NONE)
+        {
+            continue;
+        }
+        copy_mesh(
+            vertices + models[model].vertex_offset,
+            indices + models[model].first_index * stride,
+            models[model].vertices,
+            models[model].indices,
+            models[model].num_vertices,
+            models[model].num_indices);
+        if (!models[model].num_proxy_indices)
+        {
+            continue;
+        }
+        copy_mesh(
+            vertices + models[model].proxy_vertex_offset,
+            indices + models[model].first_proxy_index * stride,
+            models[model].proxy_vertices,
+            models[model].proxy_indices,
+            models[model].num_proxy_vertices,
+            models[model].num_proxy_indices);
+    }
+    SDL_UnmapGPUTransferBuffer(device, vtbo);
+    SDL_UnmapGPUTransferBuffer(device, itbo);
+    SDL_GPUTransferBufferLocation location = {0};
+    SDL_GPUBufferRegion region = {0};
+    location.transfer_buffer = vtbo;
+    region.buffer = next_vbo;
+    region.size = num_vertices * sizeof(vertex_t);
+    SDL_UploadToGPUBuffer(pass, &location, &region, false);
+    location.transfer_buffer = itbo;
+    region.buffer = next_ibo;
+    region.size = num_indices * stride;
+    SDL_UploadToGPUBuffer(pass, &location, &region, false);
+    SDL_ReleaseGPUTransferBuffer(device, vtbo);
+    SDL_ReleaseGPUTransferBuffer(device, itbo);
+    /* released buffers live on until the frames still using them finish */
+    if (vbo)
+    {
+        SDL_ReleaseGPUBuffer(device, vbo);
+    }
+    if (ibo)
+    {
+        SDL_ReleaseGPUBuffer(device, ibo);
+    }
+    vbo = next_vbo;
+    ibo = next_ibo;
+    return true;
+error:
+    if (vertices)
+    {
+        SDL_UnmapGPUTransferBuffer(device, vtbo);
+    }
+    if (indices)
+    {
+        SDL_UnmapGPUTransferBuffer(device, itbo);
+    }
+    SDL_ReleaseGPUTransferBuffer(device, vtbo);
+    SDL_ReleaseGPUTransferBuffer(device, itbo);
+    if (next_vbo)
+    {
+        SDL_ReleaseGPUBuffer(device, next_vbo);
+    }
+    if (next_ibo)
+    {
+        SDL_ReleaseGPUBuffer(device, next_ibo);
+    }
+    return false;
+}
+
+static void load_model(
+    const model_t model)
+{
+    load_t* load = &models[model].load;
+    const char* str = models[model].str;
+    const char* source = models[model].mesh;
+    const char* extension = SDL_strrchr(source, '.');
+    if (extension && !SDL_strcasecmp(extension, ".vox"))
+    {
+        /* the vox holds the palette too so it's read even on a cache hit */
+        size_t size;
+        const uint8_t* file = vfs_map(source, &size);
+        vox_t vox;
+        if (!file || !parse_vox(file, size, &vox))
+        {
+            SDL_Log("Failed to parse model: %s", source);
+            if (file)
+            {
+                vfs_unmap(file, size);
+            }
+            return;
+        }
+        memcpy(load->palette, vox.palette, sizeof(load->palette));
+        load->cached = load_cache(model, source);
+        const bool status = load->cached || load_vox(model, &vox);
+        vfs_unmap(file, size);
+        if (!status)
+        {
+            SDL_Log("Failed to load model: %s", str);
+            return;
+        }
+    }
+    else
+    {
+        const char* png = models[model].png;
+        size_t size;
+        const uint8_t* file = vfs_map(png, &size);
+        if (!file)
+        {
+            SDL_Log("Failed to load palette: %s", png);
+            return;
+        }
+        int width;
+        int height;
+        int channels;
+        uint8_t* pixels = stbi_load_from_memory(file, size, &width, &height, &channels, 4);
+        vfs_unmap(file, size);
+        if (!pixels)
+        {
+            SDL_Log("Failed to load palette: %s, %s", png, stbi_failure_reason());
+            return;
+        }
+        if (width != MODEL_PALETTE_SIZE || height != 1)
+        {
+            SDL_Log("Palette must be a %dx1 row: %s", MODEL_PALETTE_SIZE, png);
+            stbi_image_free(pixels);
+            return;
+        }
+        memcpy(load->palette, pixels, sizeof(load->palette));
+        stbi_image_free(pixels);
+        load->cached = load_cache(model, source);
+        if (!load->cached && !load_obj(model, source))
+        {
+            SDL_Log("Failed to load model: %s", str);
+            return;
+        }
+    }
+    if (!load->cached && (!optimize(model) || !load_proxy(model) || !load_positions(model)))
+    {
+        return;
+    }
+    load_slab(model);
+    if (!load->cached)
+    {
+        save_cache(model, source);
+    }
+    load->status = true;
+}
+
+static bool load_placeholder()
+{
+    /* a flat grey box on the tile footprint, drawn until a model is resident */
+    const int dims[3] = { 4, 1, 4 };
+    const int origin[3] = { -2, 0, -2 };
+    uint8_t colors[16];
+    memset(colors, 1, sizeof(colors));
+    models[PLACEHOLDER].vertices = malloc(16 * 6 * 4 * sizeof(vertex_t));
+    models[PLACEHOLDER].indices = malloc(16 * 6 * 6 * sizeof(uint32_t));
+    if (!models[PLACEHOLDER].vertices || !models[PLACEHOLDER].indices || !mesh_voxels(
+        colors,
+        dims,
+        origin,
+        MODEL_SIZE / 4,
+        models[PLACEHOLDER].vertices,
+        models[PLACEHOLDER].indices,
+        &models[PLACEHOLDER].num_vertices,
+        &models[PLACEHOLDER].num_indices))
+    {
+        return false;
+    }
+    models[PLACEHOLDER].height = MODEL_SIZE / 4;
+    memset(models[PLACEHOLDER].load.palette, 128, 4);
+    models[PLACEHOLDER].load.palette[3] = 255;
+    return load_positions(PLACEHOLDER);
+}
+
+static void load_job(
+    void* data,
+    const int index)
+{
+    const model_t* batch = data;
+    const model_t model = batch[index];
+    const uint64_t start = SDL_GetPerformanceCounter();
+    load_model(model);
+    if (models[model].load.status)
+    {
+        const double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+        SDL_Log("Loaded model: %s, %.3f ms, %s", models[model].str, ms, models[model].load.cached ? "cached" : "built");
+    }
+}
+
+/* the loader takes everything queued so far and decodes it in parallel on
+the pool, models queued meanwhile go into the next batch */
+static int loop(
+    void* args)
+{
+    model_t* batch = NULL;
+    SDL_LockMutex(mutex);
+    while (!quit)
+    {
+        if (!stbds_arrlen(queue))
+        {
+            SDL_WaitCondition(condition, mutex);
+            continue;
+        }
+        model_t* next = queue;
+        queue = batch;
+        batch = next;
+        stbds_arrsetlen(queue, 0);
+        SDL_UnlockMutex(mutex);
+        const int count = stbds_arrlen(batch);
+        pool_run(load_job, batch, count);
+        SDL_LockMutex(mutex);
+        for (int i = 0; i < count; i++)
+        {
+            const model_t model = batch[i];
+            models[model].state = models[model].load.status ? STATE_LOADED : STATE_FAILED;
+            if (models[model].load.status)
+            {
+                stbds_arrput(arrivals, model);
+            }
+        }
+        num_queued -= count;
+        SDL_BroadcastCondition(condition);
+    }
+    SDL_UnlockMutex(mutex);
+    stbds_arrfree(batch);
+    return 0;
+}
+
+/* palettes are single rows, so each is a layer of one array. vertices only
+hold the index into the row and the instances select the layer */
+static bool upload_palette(
+    SDL_GPUDevice* device,
+    SDL_GPUCopyPass* pass,
+    const int model,
+    const int slot)
+{
+    const int width = MODEL_PALETTE_SIZE;
+    SDL_GPUTransferBufferCreateInfo tbci = {0};
+    tbci.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+    tbci.size = width * 4;
+    SDL_GPUTransferBuffer* tbo = SDL_CreateGPUTransferBuffer(device, &tbci);
+    if (!tbo)
+    {
+        SDL_Log("Failed to create transfer buffer: %s", SDL_GetError());
+        return false;
+    }
+    uint8_t* data = SDL_MapGPUTransferBuffer(device, tbo, false);
+    if (!data)
+    {
+        SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
+        SDL_ReleaseGPUTransferBuffer(device, tbo);
+        return false;
+    }
+    memcpy(data, models[model].load.palette, width * 4);
+    SDL_UnmapGPUTransferBuffer(device, tbo);
+    SDL_GPUTextureTransferInfo tti = {0};
+    SDL_GPUTextureRegion region = {0};
+    tti.transfer_buffer = tbo;
+    region.texture = palette;
+    region.layer = slot;
+    region.w = width;
+    region.h = 1;
+    region.d = 1;
+    SDL_UploadToGPUTexture(pass, &tti, &region, false);
+    SDL_ReleaseGPUTransferBuffer(device, tbo);
+    return true;
+}
+
+/* one model per line: name, mesh, palette (- for vox), spread and passes as
+a comma separated list of model, ray and sun. # starts a comment */
+static bool load_manifest()
+{
+    size_t size;
+    const char* data = vfs_map(MODEL_MANIFEST, &size);
+    if (!data)
+    {
+        SDL_Log("Failed to load manifest: %s", MODEL_MANIFEST);
+        return false;
+    }
+    bool status = true;
+    size_t start = 0;
+    while (start < size && status)
+    {
+        size_t end = start;
+        while (end < size && data[end] != '\n')
+        {
+            end++;
+        }
+        char line[256] = {0};
+        memcpy(line, data + start, min(end - start, sizeof(line) - 1));
+        start = end + 1;
+        char* comment = strchr(line, '#');
+        if (comment)
+        {
+            *comment = 0;
+        }
+        char name[NAME_SIZE];
+        char mesh[NAME_SIZE];
+        char png[NAME_SIZE];
+        char flags[NAME_SIZE];
+        int spread;
+        const int count = sscanf(line, "%63s %63s %63s %d %63s", name, mesh, png, &spread, flags);
+        if (count <= 0)
+        {
+            continue;
+        }
+        if (count != 5)
+        {
+            SDL_Log("Failed to parse manifest line: %s", line);
+            status = false;
+            break;
+        }
+        int passes = 0;
+        char* state;
+        for (char* flag = SDL_strtok_r(flags, ",", &state); flag; flag = SDL_strtok_r(NULL, ",", &state))
+        {
+            if (!strcmp(flag, "model"))
+            {
+                passes |= MODEL_PASS_MODEL;
+            }
+            else if (!strcmp(flag, "ray"))
+            {
+                passes |= MODEL_PASS_RAY;
+            }
+            else if (!strcmp(flag, "sun"))
+            {
+                passes |= MODEL_PASS_SUN;
+            }
+            else
+            {
+                SDL_Log("Failed to parse pass: %s, %s", name, flag);
+                status = false;
+            }
+        }
+        if (status && model_register(name, mesh, strcmp(png, "-") ? png : NULL, spread, passes) == MODEL_NONE)
+        {
+            status = false;
+        }
+    }
+    vfs_unmap(data, size);
+    if (status && !num_models)
+    {
+        SDL_Log("Failed to find models in manifest: %s", MODEL_MANIFEST);
+        status = false;
+    }
+    return status;
+}
+
+bool model_init(
+    SDL_GPUDevice* device)
+{
+    assert(device);
+    /* models are decoded on a thread of their own so the frame never waits */
+    mutex = SDL_CreateMutex();
+    condition = SDL_CreateCondition();
+    if (!mutex || !condition)
+    {
+        SDL_Log("Failed to create model synchronization: %s", SDL_GetError());
+        model_free(device);
+        return false;
+    }
+    for (int slot = 0; slot < MAX_SLOTS; slot++)
+    {
+        owners[slot] = MODEL_NONE;
+    }
+    entry_t placeholder = {0};
+    stbds_arrput(models, placeholder);
+    if (!load_manifest())
+    {
+        model_free(device);
+        return false;
+    }
+    SDL_GPUTextureCreateInfo tci = {0};
+    tci.usage = SDL_GPU_TEXTUREUSAGE_SAMPLER;
+    tci.type = SDL_GPU_TEXTURETYPE_2D_ARRAY;
+    tci.format = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
+    tci.width = MODEL_PALETTE_SIZE;
+    tci.height = 1;
+    tci.layer_count_or_depth = MAX_SLOTS;
+    tci.num_levels = 1;
+    palette = SDL_CreateGPUTexture(device, &tci);
+    if (!palette)
+    {
+        SDL_Log("Failed to create palette: %s", SDL_GetError());
+        model_free(device);
+        return false;
+    }
+    if (!load_placeholder())
+    {
+        SDL_Log("Failed to load placeholder");
+        model_free(device);
+        return false;
+    }
+    SDL_GPUCommandBuffer* commands = SDL_AcquireGPUCommandBuffer(device);
+    if (!commands)
+    {
+        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+        model_free(device);
+        return false;
+    }
+    SDL_GPUCopyPass* pass = SDL_BeginGPUCopyPass(commands);
+    if (!pass)
+    {
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        SDL_CancelGPUCommandBuffer(commands);
+        model_free(device);
+        return false;
+    }
+    const bool status = upload_palette(device, pass, PLACEHOLDER, 0) && upload(device, pass);
+    SDL_EndGPUCopyPass(pass);
+    SDL_SubmitGPUCommandBuffer(commands);
+    if (!status)
+    {
+        SDL_Log("Failed to upload placeholder");
+        model_free(device);
+        return false;
+    }
+    quit = false;
+    thread = SDL_CreateThread(loop, "model", NULL);
+    if (!thread)
+    {
+        SDL_Log("Failed to create thread: %s", SDL_GetError());
+        model_free(device);
+        return false;
+    }
+    return true;
+}
+
+void model_free(
+    SDL_GPUDevice* device)
+{
+    assert(device);
+    if (thread)
+    {
+        SDL_LockMutex(mutex);
+        quit = true;
+        SDL_BroadcastCondition(condition);
+        SDL_UnlockMutex(mutex);
+        SDL_WaitThread(thread, NULL);
+        thread = NULL;
+    }
+    if (mutex)
+    {
+        SDL_DestroyMutex(mutex);
+        mutex = NULL;
+    }
+    if (condition)
+    {
+        SDL_DestroyCondition(condition);
+        condition = NULL;
+    }
+    if (vbo)
+    {
+        SDL_ReleaseGPUBuffer(device, vbo);
+        vbo = NULL;
+    }
+    if (ibo)
+    {
+        SDL_ReleaseGPUBuffer(device, ibo);
+        ibo = NULL;
+    }
+    if (palette)
+    {
+        SDL_ReleaseGPUTexture(device, palette);
+        palette = NULL;
+    }
+    for (int model = 0; model < stbds_arrlen(models); model++)
+    {
+        if (models[model].cache)
+        {
+            unmap_file(models[model].cache, models[model].cache_size);
+        }
+        else
+        {
+            free(models[model].vertices);
+            free(models[model].indices);
+            free(models[model].proxy_vertices);
+            free(models[model].proxy_indices);
+        }
+        free(models[model].positions);
+        free(models[model].position_indices);
+    }
+    stbds_arrfree(models);
+    stbds_arrfree(queue);
+    stbds_arrfree(arrivals);
+    stbds_arrfree(waiting);
+    num_models = 0;
+    max_spread = 0;
+    num_queued = 0;
+}
+
+model_t model_register(
+    const char* name,
+    const char* mesh,
+    const char* palette,
+    const int spread,
+    const int passes)
+{
+    assert(name);
+    assert(mesh);
+    if (num_models == MODEL_NONE)
+    {
+        SDL_Log("Failed to register model: %s, too many models", name);
+        return MODEL_NONE;
+    }
+    if (strlen(name) >= NAME_SIZE || strlen(mesh) >= NAME_SIZE || (palette && strlen(palette) >= NAME_SIZE))
+    {
+        SDL_Log("Failed to register model: %s, name too long", name);
+        return MODEL_NONE;
+    }
+    entry_t entry = {0};
+    for (int i = 0; name[i]; i++)
+    {
+        entry.str[i] = tolower(name[i]);
+    }
+    strcpy(entry.mesh, mesh);
+    if (palette)
+    {
+        strcpy(entry.png, palette);
+    }
+    entry.spread = spread;
+    entry.passes = passes;
+    /* aliases of the same files share one resident mesh and palette */
+    entry.source = num_models;
+    for (model_t model = 0; model < num_models; model++)
+    {
+        if (!strcmp(models[model].mesh, entry.mesh) && !strcmp(models[model].png, entry.png))
+        {
+            entry.source = models[model].source;
+            break;
+        }
+    }
+    /* the loader writes into its entry, so the table only moves while it's
+    idle. the placeholder stays last */
+    SDL_LockMutex(mutex);
+    while (num_queued > 0)
+    {
+        SDL_WaitCondition(condition, mutex);
+    }
+    stbds_arrins(models, num_models, entry);
+    const model_t model = num_models++;
+    max_spread = max(max_spread, spread);
+    SDL_UnlockMutex(mutex);
+    return model;
+}
+
+model_t model_find(
+    const char* name)
+{
+    assert(name);
+    for (model_t model = 0; model < num_models; model++)
+    {
+        if (!SDL_strcasecmp(models[model].str, name))
+        {
+            return model;
+        }
+    }
+    return MODEL_NONE;
+}
+
+int model_get_count()
+{
+    return num_models;
+}
+
+void model_request(
+    const model_t model)
+{
+    assert(model < num_models);
+    if (models[model].requested)
+    {
+        return;
+    }
+    models[model].requested = true;
+    const int source = models[model].source;
+    if (models[source].users++)
+    {
+        return;
+    }
+    SDL_LockMutex(mutex);
+    if (models[source].state == STATE_UNLOADED)
+    {
+        models[source].state = STATE_QUEUED;
+        stbds_arrput(queue, source);
+        num_queued++;
+        SDL_BroadcastCondition(condition);
+    }
+    else if (models[source].state == STATE_LOADED && !models[source].slot)
+    {
+        /* evicted while nothing used it, it's still decoded */
+        stbds_arrput(waiting, source);
+    }
+    SDL_UnlockMutex(mutex);
+}
+
+/* released models keep their slot until another model needs it */
+void model_release(
+    const model_t model)
+{
+    assert(model < num_models);
+    if (!models[model].requested)
+    {
+        return;
+    }
+    models[model].requested = false;
+    models[models[model].source].users--;
+}
+
+void model_wait()
+{
+    SDL_LockMutex(mutex);
+    while (num_queued > 0)
+    {
+        SDL_WaitCondition(condition, mutex);
+    }
+    SDL_UnlockMutex(mutex);
+}
+
+bool model_is_idle()
+{
+    SDL_LockMutex(mutex);
+    const bool idle = num_queued == 0 && !stbds_arrlen(arrivals) && !stbds_arrlen(waiting);
+    SDL_UnlockMutex(mutex);
+    return idle;
+}
+
+static int find_slot()
+{
+    /* free slots first, then those of models nothing uses anymore */
+    for (int slot = 1; slot < MAX_SLOTS; slot++)
+    {
+        if (owners[slot] == MODEL_NONE)
+        {
+            return slot;
+        }
+    }
+    for (int slot = 1; slot < MAX_SLOTS; slot++)
+    {
+        if (!models[owners[slot]].users)
+        {
+            return slot;
+        }
+    }
+    return 0;
+}
+
+bool model_update(
+    SDL_GPUDevice* device)
+{
+    assert(device);
+    SDL_LockMutex(mutex);
+    for (int i = 0; i < stbds_arrlen(arrivals); i++)
+    {
+        stbds_arrput(waiting, arrivals[i]);
+    }
+    stbds_arrsetlen(arrivals, 0);
+    SDL_UnlockMutex(mutex);
+    model_t placed[MAX_SLOTS];
+    model_t evicted[MAX_SLOTS];
+    int evicted_slots[MAX_SLOTS];
+    int num_placed = 0;
+    int num_evicted = 0;
+    int i = 0;
+    for (; i < stbds_arrlen(waiting); i++)
+    {
+        const model_t model = waiting[i];
+        if (!models[model].users || models[model].slot)
+        {
+            continue;
+        }
+        const int slot = find_slot();
+        if (!slot)
+        {
+            /* everything resident is in use, the rest stay placeholders */
+            break;
+        }
+        if (owners[slot] != MODEL_NONE)
+        {
+            evicted[num_evicted] = owners[slot];
+            evicted_slots[num_evicted++] = slot;
+            set_slot(owners[slot], 0);
+        }
+        set_slot(model, slot);
+        placed[num_placed++] = model;
+    }
+    stbds_arrdeln(waiting, 0, i);
+    if (!num_placed)
+    {
+        return false;
+    }
+    SDL_GPUCommandBuffer* commands = SDL_AcquireGPUCommandBuffer(device);
+    SDL_GPUCopyPass* pass = NULL;
+    bool status = true;
+    if (!commands)
+    {
+        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+        goto error;
+    }
+    pass = SDL_BeginGPUCopyPass(commands);
+    if (!pass)
+    {
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        goto error;
+    }
+    for (int j = 0; j < num_placed && status; j++)
+    {
+        status = upload_palette(device, pass, placed[j], models[placed[j]].slot);
+    }
+    if (!status || !upload(device, pass))
+    {
+        goto error;
+    }
+    SDL_EndGPUCopyPass(pass);
+    SDL_SubmitGPUCommandBuffer(commands);
+    return true;
+error:
+    /* nothing is submitted, so the old buffers and palettes still match the
+    slots from before and the models stay placeholders */
+    SDL_Log("Failed to upload %d model(s)", num_placed);
+    if (pass)
+    {
+        SDL_EndGPUCopyPass(pass);
+    }
+    if (commands)
+    {
+        SDL_CancelGPUCommandBuffer(commands);
+    }
+    /* they left the waiting list when they were placed, so they go back on
+    to be retried next update */
+    for (int j = 0; j < num_placed; j++)
+    {
+        owners[models[placed[j]].slot] = MODEL_NONE;
+        set_slot(placed[j], 0);
+        stbds_arrput(waiting, placed[j]);
+    }
+    for (int j = 0; j < num_evicted; j++)
+    {
+        set_slot(evicted[j], evicted_slots[j]);
+    }
+    int num_vertices;
+    int num_indices;
+    layout(&num_vertices, &num_indices);
+    return false;
+}
+
+SDL_GPUBuffer* model_get_vbo()
+{
+    return vbo;
+}
+
+SDL_GPUBuffer* model_get_ibo()
+{
+    return ibo;
+}
+
+SDL_GPUIndexElementSize model_get_index_size()
+{
+    return index_size;
+}
+
+SDL_GPUTexture* model_get_palette()
+{
+    return palette;
+}
+
+/* everything derived from the mesh comes from the placeholder until then */
+static int get_mesh(
+    const model_t model)
+{
+    assert(model < num_models);
+    const int source = models[model].source;
+    return models[source].slot ? source : PLACEHOLDER;
+}
+
+/* the palette layer of the resident mesh, the placeholder's until then */
+int model_get_layer(
+    const model_t model)
+{
+    return models[get_mesh(model)].slot;
+}
+
+int model_get_num_indices(
+    const model_t model)
+{
+    return models[get_mesh(model)].num_indices;
+}
+
+int model_get_first_index(
+    const model_t model)
+{
+    return models[get_mesh(model)].first_index;
+}
+
+int model_get_vertex_offset(
+    const model_t model)
+{
+    return models[get_mesh(model)].vertex_offset;
+}
+
+/* the proxy falls back to the full mesh when it wouldn't save anything */
+int model_get_num_proxy_indices(
+    const model_t model)
+{
+    const int mesh = get_mesh(model);
+    if (!models[mesh].num_proxy_indices)
+    {
+        return models[mesh].num_indices;
+    }
+    return models[mesh].num_proxy_indices;
+}
+
+int model_get_first_proxy_index(
+    const model_t model)
+{
+    const int mesh = get_mesh(model);
+    if (!models[mesh].num_proxy_indices)
+    {
+        return models[mesh].first_index;
+    }
+    return models[mesh].first_proxy_index;
+}
+
+int model_get_proxy_vertex_offset(
+    const model_t model)
+{
+    const int mesh = get_mesh(model);
+    if (!models[mesh].num_proxy_indices)
+    {
+        return models[mesh].vertex_offset;
+    }
+    return models[mesh].proxy_vertex_offset;
+}
+
+int model_get_height(
+    const model_t model)
+{
+    return models[get_mesh(model)].height;
+}
+
+int model_get_spread(
+    const model_t model)
+{
+    assert(model < num_models);
+    return models[model].spread;
+}
+
+/* how far any light can reach, which bounds what the view needs around it */
+int model_get_max_spread()
+{
+    return max_spread;
+}
+
+int model_get_passes(
+    const model_t model)
+{
+    assert(model < num_models);
+    return models[model].passes;
+}
+
+const float* model_get_positions(
+    const model_t model)
+{
+    return models[get_mesh(model)].positions;
+}
+
+const uint32_t* model_get_position_indices(
+    const model_t model)
+{
+    return models[get_mesh(model)].position_indices;
+}
+
+int model_get_num_positions(
+    const model_t model)
+{
+    return models[get_mesh(model)].num_positions;
+}
+
+int model_get_num_position_indices(
+    const model_t model)
+{
+    return models[get_mesh(model)].num_position_indices;
+}
+
+const model_slab_t* model_get_slab(
+    const model_t model)
+{
+    const int mesh = get_mesh(model);
+    if (!models[mesh].is_slab)
+    {
+        return NULL;
+    }
+    return &models[mesh].slab;
 }
 
 const char* model_get_str(
     const model_t model)
 {
-    assert(model < MODEL_COUNT);
+    assert(model < num_models);
     return models[model].str;
 }
\ No newline at end of file
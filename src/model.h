@@ -1,47 +1,106 @@
 #pragma once
 
 #include <SDL3/SDL.h>
+#include <stdint.h>
 
-#define MODELS \
-    X(GRASS, 0) \
-    X(DIRT, 0) \
-    X(WATER, 0) \
-    X(ROCK1, 0) \
-    X(ROCK2, 0) \
-    X(ROCK3, 0) \
-    X(ROCK4, 0) \
-    X(ROCK5, 0) \
-    X(SAND, 0) \
-    X(TREE1, 0) \
-    X(TREE2, 0) \
-    X(TREE3, 0) \
-    X(LAVA, 50) \
-    X(LIGHTHOUSE, 150) \
-
-typedef enum
+/* passes a model takes part in, ground slabs never occlude */
+#define MODEL_PASS_MODEL (1 << 0)
+#define MODEL_PASS_RAY (1 << 1)
+#define MODEL_PASS_SUN (1 << 2)
+#define MODEL_PASS_ALL (MODEL_PASS_MODEL | MODEL_PASS_RAY | MODEL_PASS_SUN)
+
+/* models are registered at runtime from the manifest and numbered in its order,
+so ids are stable as long as new models are only appended */
+typedef uint16_t model_t;
+#define MODEL_NONE UINT16_MAX
+
+/* voxel meshes sit on an integer lattice with axis aligned normals, so a
+vertex packs into the position and one word holding the palette index in the
+low bits and the normal (+x, -x, +y, -y, +z, -z) in the top three */
+typedef struct
+{
+    int16_t x;
+    int16_t y;
+    int16_t z;
+    uint16_t data;
+}
+vertex_t;
+
+#define MODEL_NORMAL_POSITIVE_X 0
+#define MODEL_NORMAL_NEGATIVE_X 1
+#define MODEL_NORMAL_POSITIVE_Y 2
+#define MODEL_NORMAL_NEGATIVE_Y 3
+#define MODEL_NORMAL_POSITIVE_Z 4
+#define MODEL_NORMAL_NEGATIVE_Z 5
+
+#define MODEL_MAX_BANDS 4
+
+/* a slab is a box covering the whole tile with a flat top, its sides made of
+horizontal bands of one palette entry each. slabs can be remeshed as terrain */
+typedef struct
 {
-#define X(name, spread) MODEL_##name,
-    MODELS
-#undef X
-    MODEL_COUNT,
+    int num_bands;
+    int heights[MODEL_MAX_BANDS + 1];
+    int palettes[MODEL_MAX_BANDS];
+    int top;
 }
-model_t;
+model_slab_t;
 
 bool model_init(
     SDL_GPUDevice* device);
 void model_free(
     SDL_GPUDevice* device);
-SDL_GPUBuffer* model_get_vbo(
+model_t model_register(
+    const char* name,
+    const char* mesh,
+    const char* palette,
+    const int spread,
+    const int passes);
+model_t model_find(
+    const char* name);
+int model_get_count();
+void model_request(
     const model_t model);
-SDL_GPUBuffer* model_get_ibo(
+void model_release(
     const model_t model);
-SDL_GPUTexture* model_get_palette(
+void model_wait();
+bool model_is_idle();
+bool model_update(
+    SDL_GPUDevice* device);
+SDL_GPUBuffer* model_get_vbo();
+SDL_GPUBuffer* model_get_ibo();
+SDL_GPUIndexElementSize model_get_index_size();
+SDL_GPUTexture* model_get_palette();
+int model_get_layer(
     const model_t model);
 int model_get_num_indices(
     const model_t model);
+int model_get_first_index(
+    const model_t model);
+int model_get_vertex_offset(
+    const model_t model);
+int model_get_num_proxy_indices(
+    const model_t model);
+int model_get_first_proxy_index(
+    const model_t model);
+int model_get_proxy_vertex_offset(
+    const model_t model);
 int model_get_height(
     const model_t model);
 int model_get_spread(
     const model_t model);
+int model_get_max_spread();
+int model_get_passes(
+    const model_t model);
+const float* model_get_positions(
+    const model_t model);
+const uint32_t* model_get_position_indices(
+    const model_t model);
+int model_get_num_positions(
+    const model_t model);
+int model_get_num_position_indices(
+    const model_t model);
+const model_slab_t* model_get_slab(
+    const model_t model);
 const char* model_get_str(
     const model_t model);
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+#define PACK_MAGIC 0x4B434150
+#define PACK_VERSION 1
+#define PACK_ALIGNMENT 64
+#define PACK_NAME_SIZE 48
+
+/* followed by the entries sorted by name and then the blobs, each aligned so
+they can be used in place from the mapping */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_entries;
+    uint32_t reserved;
+}
+pack_header_t;
+
+/* the hash stands in for a modify time so caches survive repacking */
+typedef struct
+{
+    char name[PACK_NAME_SIZE];
+    uint64_t offset;
+    uint64_t size;
+    uint64_t hash;
+}
+pack_entry_t;
\ No newline at end of file
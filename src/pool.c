@@ -0,0 +1,199 @@
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "helpers.h"
+#include "pool.h"
+
+#define MAX_THREADS 64
+
+/* each call owns its job so a late worker can only reach jobs still queued */
+typedef struct job
+{
+    pool_func_t func;
+    void* data;
+    int count;
+    SDL_AtomicInt next;
+    int done;
+    int active;
+    bool queued;
+    struct job* link;
+}
+job_t;
+
+static SDL_Thread* threads[MAX_THREADS];
+static int num_threads;
+static SDL_Mutex* mutex;
+static SDL_Condition* start;
+static SDL_Condition* finish;
+static job_t* jobs;
+static bool quit;
+
+static void dequeue(
+    job_t* job)
+{
+    if (!job->queued)
+    {
+        return;
+    }
+    job_t** it = &jobs;
+    while (*it != job)
+    {
+        it = &(*it)->link;
+    }
+    *it = job->link;
+    job->queued = false;
+}
+
+static void work(
+    job_t* job)
+{
+    int completed = 0;
+    while (true)
+    {
+        const int index = SDL_AddAtomicInt(&job->next, 1);
+        if (index >= job->count)
+        {
+            break;
+        }
+        job->func(job->data, index);
+        completed++;
+    }
+    SDL_LockMutex(mutex);
+    dequeue(job);
+    job->done += completed;
+    SDL_UnlockMutex(mutex);
+}
+
+static int loop(
+    void* args)
+{
+    SDL_LockMutex(mutex);
+    while (true)
+    {
+        while (!quit && !jobs)
+        {
+            SDL_WaitCondition(start, mutex);
+        }
+        if (quit)
+        {
+            SDL_UnlockMutex(mutex);
+            return 0;
+        }
+        job_t* job = jobs;
+        job->active++;
+        SDL_UnlockMutex(mutex);
+        work(job);
+        SDL_LockMutex(mutex);
+        job->active--;
+        SDL_BroadcastCondition(finish);
+    }
+}
+
+bool pool_init(
+    const int count)
+{
+    assert(!num_threads);
+    mutex = SDL_CreateMutex();
+    start = SDL_CreateCondition();
+    finish = SDL_CreateCondition();
+    if (!mutex || !start || !finish)
+    {
+        SDL_Log("Failed to create pool synchronization: %s", SDL_GetError());
+        pool_free();
+        return false;
+    }
+    quit = false;
+    /* the calling thread also works so it counts as one of the threads */
+    for (int i = 0; i < min(count, MAX_THREADS) - 1; i++)
+    {
+        threads[i] = SDL_CreateThread(loop, "pool", NULL);
+        if (!threads[i])
+        {
+            SDL_Log("Failed to create thread: %s", SDL_GetError());
+            pool_free();
+            return false;
+        }
+        num_threads++;
+    }
+    return true;
+}
+
+void pool_free()
+{
+    if (mutex)
+    {
+        SDL_LockMutex(mutex);
+        quit = true;
+        SDL_BroadcastCondition(start);
+        SDL_UnlockMutex(mutex);
+    }
+    for (int i = 0; i < num_threads; i++)
+    {
+        SDL_WaitThread(threads[i], NULL);
+        threads[i] = NULL;
+    }
+    num_threads = 0;
+    if (mutex)
+    {
+        SDL_DestroyMutex(mutex);
+        mutex = NULL;
+    }
+    if (start)
+    {
+        SDL_DestroyCondition(start);
+        start = NULL;
+    }
+    if (finish)
+    {
+        SDL_DestroyCondition(finish);
+        finish = NULL;
+    }
+}
+
+/* safe to call from several threads at once, the workers share the queued
+jobs in order */
+void pool_run(
+    const pool_func_t func,
+    void* data,
+    const int count)
+{
+    assert(func);
+    if (!num_threads || count <= 1)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            func(data, i);
+        }
+        return;
+    }
+    job_t job = {0};
+    job.func = func;
+    job.data = data;
+    job.count = count;
+    job.queued = true;
+    SDL_SetAtomicInt(&job.next, 0);
+    SDL_LockMutex(mutex);
+    job_t** it = &jobs;
+    while (*it)
+    {
+        it = &(*it)->link;
+    }
+    *it = &job;
+    SDL_BroadcastCondition(start);
+    SDL_UnlockMutex(mutex);
+    work(&job);
+    /* once dequeued no worker can pick the job up again, so it is finished
+    when every index is done and nobody is still inside */
+    SDL_LockMutex(mutex);
+    dequeue(&job);
+    while (job.done < count || job.active > 0)
+    {
+        SDL_WaitCondition(finish, mutex);
+    }
+    SDL_UnlockMutex(mutex);
+}
+
+int pool_get_num_threads()
+{
+    return num_threads + 1;
+}
\ No newline at end of file
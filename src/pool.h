@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdbool.h>
+
+typedef void (*pool_func_t)(
+    void* data,
+    const int index);
+
+bool pool_init(
+    const int count);
+void pool_free();
+void pool_run(
+    const pool_func_t func,
+    void* data,
+    const int count);
+int pool_get_num_threads();
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include <SDL3/SDL.h>
+#include <spirv_reflect.h>
+#include <stddef.h>
+#include <string.h>
+#include "reflect.h"
+
+bool reflect_shader(
+    SDL_GPUShaderCreateInfo* info,
+    const char* file,
+    const void* code,
+    const size_t size)
+{
+    SpvReflectShaderModule module;
+    SpvReflectResult result = spvReflectCreateShaderModule(size, code, &module);
+    if (result != SPV_REFLECT_RESULT_SUCCESS)
+    {
+        return false;
+    }
+    for (int i = 0; i < module.descriptor_binding_count; i++)
+    {
+        switch (module.descriptor_bindings[i].descriptor_type)
+        {
+        case SPV_REFLECT_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+            info->num_uniform_buffers++;
+            break;
+        case SPV_REFLECT_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+            info->num_samplers++;
+            break;
+        case SPV_REFLECT_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+            info->num_storage_buffers++;
+            break;
+        case SPV_REFLECT_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+            info->num_storage_textures++;
+            break;
+        }
+    }
+    spvReflectDestroyShaderModule(&module);
+    if (strstr(file, ".vert"))
+    {
+        info->stage = SDL_GPU_SHADERSTAGE_VERTEX;
+    }
+    else
+    {
+        info->stage = SDL_GPU_SHADERSTAGE_FRAGMENT;
+    }
+    info->format = SDL_GPU_SHADERFORMAT_SPIRV;
+    info->entrypoint = "main";
+    return true;
+}
+
+bool reflect_compute_pipeline(
+    SDL_GPUComputePipelineCreateInfo* info,
+    const void* code,
+    const size_t size)
+{
+    SpvReflectShaderModule module;
+    SpvReflectResult result = spvReflectCreateShaderModule(size, code, &module);
+    if (result != SPV_REFLECT_RESULT_SUCCESS)
+    {
+        return false;
+    }
+    const SpvReflectEntryPoint* entry = spvReflectGetEntryPoint(&module, "main");
+    if (!entry)
+    {
+        spvReflectDestroyShaderModule(&module);
+        return false;
+    }
+    info->threadcount_x = entry->local_size.x;
+    info->threadcount_y = entry->local_size.y;
+    info->threadcount_z = entry->local_size.z;
+    for (int i = 0; i < module.descriptor_binding_count; ++i)
+    {
+        const SpvReflectDescriptorBinding* binding = &module.descriptor_bindings[i];
+        switch (binding->descriptor_type)
+        {
+        case SPV_REFLECT_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+            info->num_uniform_buffers++;
+            break;
+        case SPV_REFLECT_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+            info->num_samplers++;
+            break;
+        case SPV_REFLECT_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+            if (binding->accessed)
+            {
+                info->num_readwrite_storage_buffers++;
+            }
+            else
+            {
+                info->num_readonly_storage_buffers++;
+            }
+            break;
+        case SPV_REFLECT_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+            if (binding->accessed)
+            {
+                info->num_readwrite_storage_textures++;
+            }
+            else
+            {
+                info->num_readonly_storage_textures++;
+            }
+            break;
+        }
+    }
+    spvReflectDestroyShaderModule(&module);
+    info->format = SDL_GPU_SHADERFORMAT_SPIRV;
+    info->entrypoint = "main";
+    return true;
+}
\ No newline at end of file
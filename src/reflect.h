@@ -0,0 +1,16 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+#include <stddef.h>
+
+/* fills everything but the code from the spirv. used by the embed tool at
+build time and by the file based path, so it can't call into sdl */
+bool reflect_shader(
+    SDL_GPUShaderCreateInfo* info,
+    const char* file,
+    const void* code,
+    const size_t size);
+bool reflect_compute_pipeline(
+    SDL_GPUComputePipelineCreateInfo* info,
+    const void* code,
+    const size_t size);
\ No newline at end of file
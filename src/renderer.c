@@ -2,10 +2,13 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 #include "camera.h"
 #include "config.h"
 #include "helpers.h"
 #include "model.h"
+#include "pool.h"
 #include "renderer.h"
 #include "world.h"
 
@@ -38,6 +41,9 @@ enum
     GRAPHICS_RAY_MODEL_FRONT,
     GRAPHICS_RAY_MODEL_BACK,
     GRAPHICS_SUN_MODEL,
+    GRAPHICS_RAY_BATCH_FRONT,
+    GRAPHICS_RAY_BATCH_BACK,
+    GRAPHICS_SUN_BATCH,
     GRAPHICS_HIGHLIGHT,
     GRAPHICS_LIGHT,
     GRAPHICS_COMPOSITE,
@@ -50,6 +56,13 @@ enum
     COMPUTE_COUNT,
 };
 
+enum
+{
+    LAZY_HIGHLIGHT,
+    LAZY_PICK,
+    LAZY_COUNT,
+};
+
 static SDL_Window* window;
 static SDL_GPUDevice* device;
 static SDL_GPUGraphicsPipeline* graphics[GRAPHICS_COUNT];
@@ -58,6 +71,21 @@ static SDL_GPUTexture* textures[TEXTURE_COUNT];
 static SDL_GPUSampler* samplers[SAMPLER_COUNT];
 static SDL_GPUTransferBuffer* sampler_tbo;
 static SDL_GPUBuffer* sampler_sbo;
+static SDL_Thread* thread;
+static SDL_Thread* lazy_threads[LAZY_COUNT];
+static const char* lazies[LAZY_COUNT] =
+{
+    [LAZY_HIGHLIGHT] = "highlight",
+    [LAZY_PICK] = "pick",
+};
+static SDL_AtomicInt state;
+static int quality = QUALITY_HIGH;
+static const char* qualities[QUALITY_COUNT] =
+{
+    [QUALITY_LOW] = "low",
+    [QUALITY_MEDIUM] = "medium",
+    [QUALITY_HIGH] = "high",
+};
 static camera_t camera;
 static camera_t ray_camera;
 static camera_t sun_camera;
@@ -70,14 +98,80 @@ static uint32_t by;
 static uint32_t bwidth;
 static uint32_t bheight;
 
-static bool create_pipelines()
+typedef struct
+{
+    SDL_GPUGraphicsPipelineCreateInfo* info;
+    const int* indices;
+    const char* names[GRAPHICS_COUNT * 2];
+    SDL_GPUShader* shaders[GRAPHICS_COUNT * 2];
+    SDL_GPUGraphicsPipeline** pipelines;
+    int num_names;
+}
+build_t;
+
+static void load_module(
+    void* data,
+    const int index)
+{
+    build_t* build = data;
+    build->shaders[index] = load_shader(device, build->names[index]);
+}
+
+static void create_pipeline(
+    void* data,
+    const int index)
+{
+    build_t* build = data;
+    const int i = build->indices[index];
+    SDL_GPUGraphicsPipeline* pipeline = NULL;
+    if (build->info[i].vertex_shader && build->info[i].fragment_shader)
+    {
+        pipeline = SDL_CreateGPUGraphicsPipeline(device, &build->info[i]);
+        if (!pipeline)
+        {
+            SDL_Log("Failed to create pipeline: %s", SDL_GetError());
+        }
+    }
+    build->pipelines[index] = pipeline;
+}
+
+/* the tier is passed in since the lazy threads don't own the current one.
+nothing is published, the caller gets a pipeline or NULL per index */
+static bool create_pipelines(
+    const int* indices,
+    const int count,
+    const int tier,
+    SDL_GPUGraphicsPipeline** pipelines)
 {
     assert(device);
+    const char* lights[QUALITY_COUNT] =
+    {
+        [QUALITY_LOW] = "light.low.frag",
+        [QUALITY_MEDIUM] = "light.medium.frag",
+        [QUALITY_HIGH] = "light.high.frag",
+    };
+    const char* composites[QUALITY_COUNT] =
+    {
+        [QUALITY_LOW] = "composite.low.frag",
+        [QUALITY_MEDIUM] = "composite.medium.frag",
+        [QUALITY_HIGH] = "composite.high.frag",
+    };
+    const char* shaders[GRAPHICS_COUNT][2] =
+    {
+        [GRAPHICS_MODEL] = { "model.vert", "model.frag" },
+        [GRAPHICS_RAY_MODEL_FRONT] = { "model.vert", "ray_model.frag" },
+        [GRAPHICS_RAY_MODEL_BACK] = { "model.vert", "ray_model.frag" },
+        [GRAPHICS_SUN_MODEL] = { "model.vert", "sun_model.frag" },
+        [GRAPHICS_RAY_BATCH_FRONT] = { "batch.vert", "ray_model.frag" },
+        [GRAPHICS_RAY_BATCH_BACK] = { "batch.vert", "ray_model.frag" },
+        [GRAPHICS_SUN_BATCH] = { "batch.vert", "sun_model.frag" },
+        [GRAPHICS_HIGHLIGHT] = { "highlight.vert", "highlight.frag" },
+        [GRAPHICS_LIGHT] = { "fullscreen_flip.vert", lights[tier] },
+        [GRAPHICS_COMPOSITE] = { "fullscreen_flip.vert", composites[tier] },
+    };
     SDL_GPUGraphicsPipelineCreateInfo info[GRAPHICS_COUNT] = {0};
     info[GRAPHICS_MODEL] = (SDL_GPUGraphicsPipelineCreateInfo)
     {
-        .vertex_shader = load_shader(device, "model.vert"),
-        .fragment_shader = load_shader(device, "model.frag"),
         .target_info =
         {
             .num_color_targets = 3,
@@ -96,49 +190,31 @@ static bool create_pipelines()
         },
         .vertex_input_state =
         {
-            .num_vertex_attributes = 5,
+            .num_vertex_attributes = 2,
             .vertex_attributes = (SDL_GPUVertexAttribute[])
             {{
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+                .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4,
                 .location = 0,
-                .offset = sizeof(float) * 0,
+                .offset = 0,
                 .buffer_slot = 0,
             },
             {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
+                .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4,
                 .location = 1,
-                .offset = sizeof(float) * 3,
-                .buffer_slot = 0,
-            },
-            {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-                .location = 2,
-                .offset = sizeof(float) * 5,
-                .buffer_slot = 0,
-            },
-            {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-                .location = 3,
-                .offset = sizeof(float) * 0,
-                .buffer_slot = 1,
-            },
-            {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT,
-                .location = 4,
-                .offset = sizeof(float) * 3,
+                .offset = sizeof(int16_t) * 0,
                 .buffer_slot = 1,
             }},
             .num_vertex_buffers = 2,
             .vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[])
             {{
                 .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
-                .pitch = sizeof(float) * 8,
+                .pitch = sizeof(vertex_t),
                 .instance_step_rate = 0,
                 .slot = 0,
             },
             {
                 .input_rate = SDL_GPU_VERTEXINPUTRATE_INSTANCE,
-                .pitch = sizeof(float) * 4,
+                .pitch = sizeof(int16_t) * 4,
                 .instance_step_rate = 1,
                 .slot = 1,
             }},
@@ -157,8 +233,6 @@ static bool create_pipelines()
     };
     info[GRAPHICS_RAY_MODEL_FRONT] = (SDL_GPUGraphicsPipelineCreateInfo)
     {
-        .vertex_shader = load_shader(device, "model.vert"),
-        .fragment_shader = load_shader(device, "ray_model.frag"),
         .target_info =
         {
             .num_color_targets = 1,
@@ -171,49 +245,31 @@ static bool create_pipelines()
         },
         .vertex_input_state =
         {
-            .num_vertex_attributes = 5,
+            .num_vertex_attributes = 2,
             .vertex_attributes = (SDL_GPUVertexAttribute[])
             {{
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+                .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4,
                 .location = 0,
-                .offset = sizeof(float) * 0,
+                .offset = 0,
                 .buffer_slot = 0,
             },
             {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
+                .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4,
                 .location = 1,
-                .offset = sizeof(float) * 3,
-                .buffer_slot = 0,
-            },
-            {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-                .location = 2,
-                .offset = sizeof(float) * 5,
-                .buffer_slot = 0,
-            },
-            {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-                .location = 3,
-                .offset = sizeof(float) * 0,
-                .buffer_slot = 1,
-            },
-            {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT,
-                .location = 4,
-                .offset = sizeof(float) * 3,
+                .offset = sizeof(int16_t) * 0,
                 .buffer_slot = 1,
             }},
             .num_vertex_buffers = 2,
             .vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[])
             {{
                 .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
-                .pitch = sizeof(float) * 8,
+                .pitch = sizeof(vertex_t),
                 .instance_step_rate = 0,
                 .slot = 0,
             },
             {
                 .input_rate = SDL_GPU_VERTEXINPUTRATE_INSTANCE,
-                .pitch = sizeof(float) * 4,
+                .pitch = sizeof(int16_t) * 4,
                 .instance_step_rate = 1,
                 .slot = 1,
             }},
@@ -232,8 +288,6 @@ static bool create_pipelines()
     };
     info[GRAPHICS_RAY_MODEL_BACK] = (SDL_GPUGraphicsPipelineCreateInfo)
     {
-        .vertex_shader = load_shader(device, "model.vert"),
-        .fragment_shader = load_shader(device, "ray_model.frag"),
         .target_info =
         {
             .num_color_targets = 1,
@@ -246,49 +300,31 @@ static bool create_pipelines()
         },
         .vertex_input_state =
         {
-            .num_vertex_attributes = 5,
+            .num_vertex_attributes = 2,
             .vertex_attributes = (SDL_GPUVertexAttribute[])
             {{
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+                .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4,
                 .location = 0,
-                .offset = sizeof(float) * 0,
+                .offset = 0,
                 .buffer_slot = 0,
             },
             {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
+                .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4,
                 .location = 1,
-                .offset = sizeof(float) * 3,
-                .buffer_slot = 0,
-            },
-            {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-                .location = 2,
-                .offset = sizeof(float) * 5,
-                .buffer_slot = 0,
-            },
-            {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-                .location = 3,
-                .offset = sizeof(float) * 0,
-                .buffer_slot = 1,
-            },
-            {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT,
-                .location = 4,
-                .offset = sizeof(float) * 3,
+                .offset = sizeof(int16_t) * 0,
                 .buffer_slot = 1,
             }},
             .num_vertex_buffers = 2,
             .vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[])
             {{
                 .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
-                .pitch = sizeof(float) * 8,
+                .pitch = sizeof(vertex_t),
                 .instance_step_rate = 0,
                 .slot = 0,
             },
             {
                 .input_rate = SDL_GPU_VERTEXINPUTRATE_INSTANCE,
-                .pitch = sizeof(float) * 4,
+                .pitch = sizeof(int16_t) * 4,
                 .instance_step_rate = 1,
                 .slot = 1,
             }},
@@ -307,8 +343,6 @@ static bool create_pipelines()
     };
     info[GRAPHICS_SUN_MODEL] = (SDL_GPUGraphicsPipelineCreateInfo)
     {
-        .vertex_shader = load_shader(device, "model.vert"),
-        .fragment_shader = load_shader(device, "sun_model.frag"),
         .target_info =
         {
             .has_depth_stencil_target = true,
@@ -316,49 +350,31 @@ static bool create_pipelines()
         },
         .vertex_input_state =
         {
-            .num_vertex_attributes = 5,
+            .num_vertex_attributes = 2,
             .vertex_attributes = (SDL_GPUVertexAttribute[])
             {{
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+                .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4,
                 .location = 0,
-                .offset = sizeof(float) * 0,
+                .offset = 0,
                 .buffer_slot = 0,
             },
             {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
+                .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4,
                 .location = 1,
-                .offset = sizeof(float) * 3,
-                .buffer_slot = 0,
-            },
-            {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-                .location = 2,
-                .offset = sizeof(float) * 5,
-                .buffer_slot = 0,
-            },
-            {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-                .location = 3,
-                .offset = sizeof(float) * 0,
-                .buffer_slot = 1,
-            },
-            {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT,
-                .location = 4,
-                .offset = sizeof(float) * 3,
+                .offset = sizeof(int16_t) * 0,
                 .buffer_slot = 1,
             }},
             .num_vertex_buffers = 2,
             .vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[])
             {{
                 .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
-                .pitch = sizeof(float) * 8,
+                .pitch = sizeof(vertex_t),
                 .instance_step_rate = 0,
                 .slot = 0,
             },
             {
                 .input_rate = SDL_GPU_VERTEXINPUTRATE_INSTANCE,
-                .pitch = sizeof(float) * 4,
+                .pitch = sizeof(int16_t) * 4,
                 .instance_step_rate = 1,
                 .slot = 1,
             }},
@@ -375,10 +391,132 @@ static bool create_pipelines()
             .front_face = SDL_GPU_FRONTFACE_COUNTER_CLOCKWISE,
         }
     };
+    info[GRAPHICS_RAY_BATCH_FRONT] = (SDL_GPUGraphicsPipelineCreateInfo)
+    {
+        .target_info =
+        {
+            .num_color_targets = 1,
+            .color_target_descriptions = (SDL_GPUColorTargetDescription[])
+            {{
+                .format = SDL_GPU_TEXTUREFORMAT_R32G32B32A32_FLOAT,
+            }},
+            .has_depth_stencil_target = true,
+            .depth_stencil_format = SDL_GPU_TEXTUREFORMAT_D32_FLOAT,
+        },
+        .vertex_input_state =
+        {
+            .num_vertex_attributes = 1,
+            .vertex_attributes = (SDL_GPUVertexAttribute[])
+            {{
+                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+                .location = 0,
+                .offset = 0,
+                .buffer_slot = 0,
+            }},
+            .num_vertex_buffers = 1,
+            .vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[])
+            {{
+                .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
+                .pitch = sizeof(float) * 3,
+                .instance_step_rate = 0,
+                .slot = 0,
+            }},
+        },
+        .depth_stencil_state =
+        {
+            .enable_depth_test = true,
+            .enable_depth_write = true,
+            .compare_op = SDL_GPU_COMPAREOP_LESS,
+        },
+        .rasterizer_state =
+        {
+            .cull_mode = SDL_GPU_CULLMODE_BACK,
+            .front_face = SDL_GPU_FRONTFACE_COUNTER_CLOCKWISE,
+        }
+    };
+    info[GRAPHICS_RAY_BATCH_BACK] = (SDL_GPUGraphicsPipelineCreateInfo)
+    {
+        .target_info =
+        {
+            .num_color_targets = 1,
+            .color_target_descriptions = (SDL_GPUColorTargetDescription[])
+            {{
+                .format = SDL_GPU_TEXTUREFORMAT_R32G32B32A32_FLOAT,
+            }},
+            .has_depth_stencil_target = true,
+            .depth_stencil_format = SDL_GPU_TEXTUREFORMAT_D32_FLOAT,
+        },
+        .vertex_input_state =
+        {
+            .num_vertex_attributes = 1,
+            .vertex_attributes = (SDL_GPUVertexAttribute[])
+            {{
+                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+                .location = 0,
+                .offset = 0,
+                .buffer_slot = 0,
+            }},
+            .num_vertex_buffers = 1,
+            .vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[])
+            {{
+                .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
+                .pitch = sizeof(float) * 3,
+                .instance_step_rate = 0,
+                .slot = 0,
+            }},
+        },
+        .depth_stencil_state =
+        {
+            .enable_depth_test = true,
+            .enable_depth_write = true,
+            .compare_op = SDL_GPU_COMPAREOP_LESS,
+        },
+        .rasterizer_state =
+        {
+            .cull_mode = SDL_GPU_CULLMODE_FRONT,
+            .front_face = SDL_GPU_FRONTFACE_COUNTER_CLOCKWISE,
+        }
+    };
+    info[GRAPHICS_SUN_BATCH] = (SDL_GPUGraphicsPipelineCreateInfo)
+    {
+        .target_info =
+        {
+            .has_depth_stencil_target = true,
+            .depth_stencil_format = SDL_GPU_TEXTUREFORMAT_D32_FLOAT,
+        },
+        .vertex_input_state =
+        {
+            .num_vertex_attributes = 1,
+            .vertex_attributes = (SDL_GPUVertexAttribute[])
+            {{
+                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+                .location = 0,
+                .offset = 0,
+                .buffer_slot = 0,
+            }},
+            .num_vertex_buffers = 1,
+            .vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[])
+            {{
+                .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
+                .pitch = sizeof(float) * 3,
+                .instance_step_rate = 0,
+                .slot = 0,
+            }},
+        },
+        .depth_stencil_state =
+        {
+            .enable_depth_test = true,
+            .enable_depth_write = true,
+            .compare_op = SDL_GPU_COMPAREOP_LESS,
+        },
+        .rasterizer_state =
+        {
+            .cull_mode = SDL_GPU_CULLMODE_BACK,
+            .front_face = SDL_GPU_FRONTFACE_COUNTER_CLOCKWISE,
+        }
+    };
     info[GRAPHICS_HIGHLIGHT] = (SDL_GPUGraphicsPipelineCreateInfo)
     {
-        .vertex_shader = load_shader(device, "highlight.vert"),
-        .fragment_shader = load_shader(device, "highlight.frag"),
         .target_info =
         {
             .num_color_targets = 1,
@@ -401,31 +539,19 @@ static bool create_pipelines()
         },
         .vertex_input_state =
         {
-            .num_vertex_attributes = 3,
+            .num_vertex_attributes = 1,
             .vertex_attributes = (SDL_GPUVertexAttribute[])
             {{
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+                .format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4,
                 .location = 0,
-                .offset = sizeof(float) * 0,
-                .buffer_slot = 0,
-            },
-            {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
-                .location = 1,
-                .offset = sizeof(float) * 3,
-                .buffer_slot = 0,
-            },
-            {
-                .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
-                .location = 2,
-                .offset = sizeof(float) * 5,
+                .offset = 0,
                 .buffer_slot = 0,
             }},
             .num_vertex_buffers = 1,
             .vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[])
             {{
                 .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
-                .pitch = sizeof(float) * 8,
+                .pitch = sizeof(vertex_t),
                 .instance_step_rate = 0,
                 .slot = 0,
             }},
@@ -439,8 +565,6 @@ static bool create_pipelines()
     };
     info[GRAPHICS_LIGHT] = (SDL_GPUGraphicsPipelineCreateInfo)
     {
-        .vertex_shader = load_shader(device, "fullscreen_flip.vert"),
-        .fragment_shader = load_shader(device, "light.frag"),
         .target_info =
         {
             .num_color_targets = 1,
@@ -452,8 +576,6 @@ static bool create_pipelines()
     };
     info[GRAPHICS_COMPOSITE] = (SDL_GPUGraphicsPipelineCreateInfo)
     {
-        .vertex_shader = load_shader(device, "fullscreen_flip.vert"),
-        .fragment_shader = load_shader(device, "composite.frag"),
         .target_info =
         {
             .num_color_targets = 1,
@@ -463,41 +585,199 @@ static bool create_pipelines()
             }},
         },
     };
-    computes[COMPUTE_SAMPLER] = load_compute_pipeline(device, "sampler.comp");
-    bool status = true;
-    for (int i = 0; i < GRAPHICS_COUNT; i++)
+    build_t build = {0};
+    build.info = info;
+    build.indices = indices;
+    build.pipelines = pipelines;
+    int modules[GRAPHICS_COUNT][2];
+    for (int i = 0; i < count; i++)
     {
-        if (info[i].fragment_shader && info[i].vertex_shader)
+        for (int j = 0; j < 2; j++)
         {
-            graphics[i] = SDL_CreateGPUGraphicsPipeline(device, &info[i]);
-            if (!graphics[i])
+            const char* name = shaders[indices[i]][j];
+            int k = 0;
+            while (k < build.num_names && strcmp(build.names[k], name))
             {
-                SDL_Log("Failed to create pipeline: %s", SDL_GetError());
-                status = false;
+                k++;
             }
+            if (k == build.num_names)
+            {
+                build.names[build.num_names++] = name;
+            }
+            modules[i][j] = k;
         }
-        else
+    }
+    /* each shader is loaded once and shared by every pipeline using it */
+    const uint64_t start = SDL_GetPerformanceCounter();
+    pool_run(load_module, &build, build.num_names);
+    const uint64_t middle = SDL_GetPerformanceCounter();
+    for (int i = 0; i < count; i++)
+    {
+        info[indices[i]].vertex_shader = build.shaders[modules[i][0]];
+        info[indices[i]].fragment_shader = build.shaders[modules[i][1]];
+    }
+    pool_run(create_pipeline, &build, count);
+    const uint64_t end = SDL_GetPerformanceCounter();
+    for (int i = 0; i < build.num_names; i++)
+    {
+        if (build.shaders[i])
         {
-            status = false;
+            SDL_ReleaseGPUShader(device, build.shaders[i]);
         }
-        if (info[i].fragment_shader)
+    }
+    bool status = true;
+    for (int i = 0; i < count; i++)
+    {
+        status &= pipelines[i] != NULL;
+    }
+    const double frequency = SDL_GetPerformanceFrequency();
+    SDL_Log("Created %d pipeline(s) from %d shader(s) on %d thread(s): shaders %.3f ms, pipelines %.3f ms",
+        count, build.num_names, pool_get_num_threads(), (middle - start) * 1000.0 / frequency, (end - middle) * 1000.0 / frequency);
+    return status;
+}
+
+/* each pipeline is published as is, the passes skip the ones that failed */
+static bool load_pipelines(
+    const int* indices,
+    const int count,
+    const int tier)
+{
+    SDL_GPUGraphicsPipeline* pipelines[GRAPHICS_COUNT];
+    const bool status = create_pipelines(indices, count, tier, pipelines);
+    for (int i = 0; i < count; i++)
+    {
+        SDL_SetAtomicPointer((void**) &graphics[indices[i]], pipelines[i]);
+    }
+    return status;
+}
+
+static bool create_computes()
+{
+    assert(device);
+    const char* shaders[COMPUTE_COUNT] =
+    {
+        [COMPUTE_SAMPLER] = "sampler.comp",
+    };
+    bool status = true;
+    for (int i = 0; i < COMPUTE_COUNT; i++)
+    {
+        SDL_GPUComputePipeline* pipeline = load_compute_pipeline(device, shaders[i]);
+        if (!pipeline)
         {
-            SDL_ReleaseGPUShader(device, info[i].fragment_shader);
+            status = false;
         }
-        if (info[i].vertex_shader)
+        SDL_SetAtomicPointer((void**) &computes[i], pipeline);
+    }
+    return status;
+}
+
+static SDL_GPUGraphicsPipeline* get_graphics(
+    const int index)
+{
+    return SDL_GetAtomicPointer((void**) &graphics[index]);
+}
+
+static SDL_GPUComputePipeline* get_compute(
+    const int index)
+{
+    return SDL_GetAtomicPointer((void**) &computes[index]);
+}
+
+/* everything but the composite and the optional pipelines is created here
+while the first frames show */
+static int loop(
+    void* args)
+{
+    const int tier = (intptr_t) args;
+    const uint64_t start = SDL_GetPerformanceCounter();
+    int indices[GRAPHICS_COUNT];
+    int count = 0;
+    for (int i = 0; i < GRAPHICS_COUNT; i++)
+    {
+        if (i != GRAPHICS_COMPOSITE && i != GRAPHICS_HIGHLIGHT)
         {
-            SDL_ReleaseGPUShader(device, info[i].vertex_shader);
+            indices[count++] = i;
         }
     }
-    for (int i = 0; i < COMPUTE_COUNT; i++)
+    const bool status = load_pipelines(indices, count, tier);
+    const double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    if (status)
+    {
+        SDL_Log("Created pipelines: %.3f ms", ms);
+        SDL_SetAtomicInt(&state, RENDERER_STATE_LOADED);
+    }
+    else
+    {
+        SDL_Log("Failed to create pipelines");
+        SDL_SetAtomicInt(&state, RENDERER_STATE_FAILED);
+    }
+    return 0;
+}
+
+static int create_lazy(
+    void* args)
+{
+    const int lazy = (intptr_t) args;
+    const uint64_t start = SDL_GetPerformanceCounter();
+    bool status;
+    if (lazy == LAZY_HIGHLIGHT)
+    {
+        /* the tier only picks the light and composite shaders */
+        const int index = GRAPHICS_HIGHLIGHT;
+        status = load_pipelines(&index, 1, QUALITY_HIGH);
+    }
+    else
     {
-        if (!computes[i])
+        status = create_computes();
+    }
+    const double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    if (status)
+    {
+        SDL_Log("Created %s pipeline: %.3f ms", lazies[lazy], ms);
+    }
+    else
+    {
+        SDL_Log("Failed to create %s pipeline", lazies[lazy]);
+    }
+    return 0;
+}
+
+/* optional pipelines are created on first use, the pass skips until then */
+static void request_lazy(
+    const int lazy)
+{
+    if (lazy_threads[lazy])
+    {
+        return;
+    }
+    lazy_threads[lazy] = SDL_CreateThread(create_lazy, "renderer", (void*) (intptr_t) lazy);
+    if (!lazy_threads[lazy])
+    {
+        SDL_Log("Failed to create thread: %s", SDL_GetError());
+    }
+}
+
+/* the tier is the first word of the file, high when there is none */
+static void load_quality()
+{
+    quality = QUALITY_HIGH;
+    char* data = SDL_LoadFile(QUALITY_PATH, NULL);
+    if (!data)
+    {
+        return;
+    }
+    char name[16] = {0};
+    sscanf(data, "%15s", name);
+    SDL_free(data);
+    for (int i = 0; i < QUALITY_COUNT; i++)
+    {
+        if (!strcmp(name, qualities[i]))
         {
-            status = false;
-            break;
+            quality = i;
+            return;
         }
     }
-    return status;
+    SDL_Log("Failed to parse quality: %s", name);
 }
 
 static bool create_textures()
@@ -617,6 +897,16 @@ static bool create_samplers()
     return true;
 }
 
+/* milliseconds since the ticks, which then move to now */
+static double get_ms(
+    uint64_t* ticks)
+{
+    const uint64_t now = SDL_GetPerformanceCounter();
+    const double ms = (now - *ticks) * 1000.0 / SDL_GetPerformanceFrequency();
+    *ticks = now;
+    return ms;
+}
+
 bool renderer_init(
     SDL_Window* a,
     SDL_GPUDevice* b)
@@ -624,12 +914,14 @@ bool renderer_init(
     assert(a);
     window = a;
     device = b;
+    uint64_t ticks = SDL_GetPerformanceCounter();
     if (!SDL_ClaimWindowForGPUDevice(device, window))
     {
         SDL_Log("Failed to create swapchain: %s", SDL_GetError());
         renderer_free();
         return false;
     }
+    const double swapchain_ms = get_ms(&ticks);
     camera_init(
         &camera,
         CAMERA_TYPE_PERSPECTIVE,
@@ -665,30 +957,46 @@ bool renderer_init(
         rad(-45.0f),
         rad(-10.0f),
         1.0f);
-    if (!create_pipelines())
+    load_quality();
+    /* the composite is enough for a frame, the other passes clear until their
+    pipelines arrive */
+    const int index = GRAPHICS_COMPOSITE;
+    if (!load_pipelines(&index, 1, quality))
     {
         SDL_Log("Failed to create pipelines: %s", SDL_GetError());
         renderer_free();
         return false;
     }
+    const double pipelines_ms = get_ms(&ticks);
+    SDL_SetAtomicInt(&state, RENDERER_STATE_LOADING);
+    thread = SDL_CreateThread(loop, "renderer", (void*) (intptr_t) quality);
+    if (!thread)
+    {
+        SDL_Log("Failed to create thread: %s", SDL_GetError());
+        renderer_free();
+        return false;
+    }
     if (!create_textures())
     {
         SDL_Log("Failed to create textures: %s", SDL_GetError());
         renderer_free();
         return false;
     }
+    const double textures_ms = get_ms(&ticks);
     if (!create_samplers())
     {
         SDL_Log("Failed to create samplers: %s", SDL_GetError());
         renderer_free();
         return false;
     }
+    const double samplers_ms = get_ms(&ticks);
     if (!model_init(device))
     {
         SDL_Log("Failed to initialize models");
         renderer_free();
         return false;
     }
+    const double models_ms = get_ms(&ticks);
     SDL_GPUTransferBufferCreateInfo tbci = {0};
     tbci.usage = SDL_GPU_TRANSFERBUFFERUSAGE_DOWNLOAD;
     tbci.size = sizeof(float) * 4;
@@ -703,11 +1011,23 @@ bool renderer_init(
         renderer_free();
         return false;
     }
+    const double buffers_ms = get_ms(&ticks);
+    SDL_Log("Initialized renderer: swapchain %.3f ms, pipelines %.3f ms, textures %.3f ms, samplers %.3f ms, models %.3f ms, buffers %.3f ms",
+        swapchain_ms, pipelines_ms, textures_ms, samplers_ms, models_ms, buffers_ms);
     return true;
 }
 
 void renderer_free()
 {
+    renderer_wait();
+    for (int i = 0; i < LAZY_COUNT; i++)
+    {
+        if (lazy_threads[i])
+        {
+            SDL_WaitThread(lazy_threads[i], NULL);
+            lazy_threads[i] = NULL;
+        }
+    }
     model_free(device);
     if (sampler_tbo)
     {
@@ -788,18 +1108,24 @@ void renderer_draw()
         SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
         return;
     }
+    SDL_PushGPUDebugGroup(commands, "cull");
+    world_cull(device, commands, WORLD_PASS_MODEL, &camera);
+    SDL_PopGPUDebugGroup(commands);
     {
         SDL_PushGPUDebugGroup(commands, "model");
+        SDL_GPUGraphicsPipeline* pipeline = get_graphics(GRAPHICS_MODEL);
+        /* the ground covers every pixel once there's a pipeline to draw it */
+        const SDL_GPULoadOp load_op = pipeline ? SDL_GPU_LOADOP_DONT_CARE : SDL_GPU_LOADOP_CLEAR;
         SDL_GPUColorTargetInfo cti[3] = {0};
-        cti[0].load_op = SDL_GPU_LOADOP_DONT_CARE;
+        cti[0].load_op = load_op;
         cti[0].store_op = SDL_GPU_STOREOP_STORE;
         cti[0].texture = textures[TEXTURE_COLOR];
         cti[0].cycle = true;
-        cti[1].load_op = SDL_GPU_LOADOP_DONT_CARE;
+        cti[1].load_op = load_op;
         cti[1].store_op = SDL_GPU_STOREOP_STORE;
         cti[1].texture = textures[TEXTURE_POSITION];
         cti[1].cycle = true;
-        cti[2].load_op = SDL_GPU_LOADOP_DONT_CARE;
+        cti[2].load_op = load_op;
         cti[2].store_op = SDL_GPU_STOREOP_STORE;
         cti[2].texture = textures[TEXTURE_NORMAL];
         cti[2].cycle = true;
@@ -816,9 +1142,12 @@ void renderer_draw()
             SDL_Log("Failed to begin render pass: %s", SDL_GetError());
             goto error;
         }
-        SDL_BindGPUGraphicsPipeline(pass, graphics[GRAPHICS_MODEL]);
-        SDL_PushGPUVertexUniformData(commands, 0, camera.matrix, 64);
-        world_draw_models(device, pass, samplers[SAMPLER_NEAREST]);
+        if (pipeline)
+        {
+            SDL_BindGPUGraphicsPipeline(pass, pipeline);
+            SDL_PushGPUVertexUniformData(commands, 0, camera.matrix, 64);
+            world_draw_models(device, commands, pass, WORLD_PASS_MODEL, samplers[SAMPLER_NEAREST]);
+        }
         SDL_EndGPURenderPass(pass);
         SDL_PopGPUDebugGroup(commands);
     }
@@ -837,7 +1166,9 @@ void renderer_pick(
     assert(x);
     assert(y);
     assert(z);
-    if (*x < bx || *x > bx + bwidth || *y < by || *y > by + bheight)
+    request_lazy(LAZY_PICK);
+    SDL_GPUComputePipeline* pipeline = get_compute(COMPUTE_SAMPLER);
+    if (!pipeline || *x < bx || *x > bx + bwidth || *y < by || *y > by + bheight)
     {
         *x = INFINITY;
         *y = INFINITY;
@@ -869,7 +1200,7 @@ void renderer_pick(
     SDL_GPUTextureSamplerBinding tsb = {0};
     tsb.sampler = samplers[SAMPLER_NEAREST];
     tsb.texture = textures[TEXTURE_POSITION];
-    SDL_BindGPUComputePipeline(pass, computes[COMPUTE_SAMPLER]);
+    SDL_BindGPUComputePipeline(pass, pipeline);
     SDL_BindGPUComputeSamplers(pass, 0, &tsb, 1);
     SDL_PushGPUComputeUniformData(commands, 0, uv, sizeof(uv));
     SDL_DispatchGPUCompute(pass, 1, 1, 1);
@@ -916,6 +1247,12 @@ void renderer_highlight(
     const float y,
     const float z)
 {
+    request_lazy(LAZY_HIGHLIGHT);
+    SDL_GPUGraphicsPipeline* pipeline = get_graphics(GRAPHICS_HIGHLIGHT);
+    if (!pipeline)
+    {
+        return;
+    }
     SDL_GPUCommandBuffer* commands = SDL_AcquireGPUCommandBuffer(device);
     if (!commands)
     {
@@ -941,14 +1278,20 @@ void renderer_highlight(
         const float instance[3] = { x, y, z };
         SDL_GPUBufferBinding vbb = {0};
         SDL_GPUBufferBinding ibb = {0};
-        vbb.buffer = model_get_vbo(model);
-        ibb.buffer = model_get_ibo(model);
-        SDL_BindGPUGraphicsPipeline(pass, graphics[GRAPHICS_HIGHLIGHT]);
+        vbb.buffer = model_get_vbo();
+        ibb.buffer = model_get_ibo();
+        SDL_BindGPUGraphicsPipeline(pass, pipeline);
         SDL_PushGPUVertexUniformData(commands, 0, camera.matrix, 64);
         SDL_PushGPUVertexUniformData(commands, 1, instance, sizeof(instance));
         SDL_BindGPUVertexBuffers(pass, 0, &vbb, 1);
-        SDL_BindGPUIndexBuffer(pass, &ibb, SDL_GPU_INDEXELEMENTSIZE_32BIT);
-        SDL_DrawGPUIndexedPrimitives(pass, model_get_num_indices(model), 1, 0, 0, 0);
+        SDL_BindGPUIndexBuffer(pass, &ibb, model_get_index_size());
+        SDL_DrawGPUIndexedPrimitives(
+            pass,
+            model_get_num_indices(model),
+            1,
+            model_get_first_index(model),
+            model_get_vertex_offset(model),
+            0);
         SDL_EndGPURenderPass(pass);
         SDL_PopGPUDebugGroup(commands);
     }
@@ -967,10 +1310,16 @@ void renderer_composite()
         SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
         return;
     }
+    SDL_PushGPUDebugGroup(commands, "cull");
+    world_cull(device, commands, WORLD_PASS_RAY_MODEL_FRONT, &ray_camera);
+    world_cull(device, commands, WORLD_PASS_RAY_MODEL_BACK, &ray_camera);
+    world_cull(device, commands, WORLD_PASS_SUN_MODEL, &sun_camera);
+    SDL_PopGPUDebugGroup(commands);
     {
         SDL_PushGPUDebugGroup(commands, "ray_model_front");
         SDL_GPUColorTargetInfo cti = {0};
-        cti.load_op = SDL_GPU_LOADOP_DONT_CARE;
+        /* ground is skipped so clear to a span that never occludes */
+        cti.load_op = SDL_GPU_LOADOP_CLEAR;
         cti.store_op = SDL_GPU_STOREOP_STORE;
         cti.texture = textures[TEXTURE_RAY_POSITION_FRONT];
         cti.cycle = true;
@@ -987,16 +1336,28 @@ void renderer_composite()
             SDL_Log("Failed to begin render pass: %s", SDL_GetError());
             goto error;
         }
-        SDL_BindGPUGraphicsPipeline(pass, graphics[GRAPHICS_RAY_MODEL_FRONT]);
-        SDL_PushGPUVertexUniformData(commands, 0, ray_camera.matrix, 64);
-        world_draw_models(device, pass, NULL);
+        SDL_GPUGraphicsPipeline* pipeline;
+        if (world_get_batched(WORLD_PASS_RAY_MODEL_FRONT))
+        {
+            pipeline = get_graphics(GRAPHICS_RAY_BATCH_FRONT);
+        }
+        else
+        {
+            pipeline = get_graphics(GRAPHICS_RAY_MODEL_FRONT);
+        }
+        if (pipeline)
+        {
+            SDL_BindGPUGraphicsPipeline(pass, pipeline);
+            SDL_PushGPUVertexUniformData(commands, 0, ray_camera.matrix, 64);
+            world_draw_models(device, commands, pass, WORLD_PASS_RAY_MODEL_FRONT, NULL);
+        }
         SDL_EndGPURenderPass(pass);
         SDL_PopGPUDebugGroup(commands);
     }
     {
         SDL_PushGPUDebugGroup(commands, "ray_model_back");
         SDL_GPUColorTargetInfo cti = {0};
-        cti.load_op = SDL_GPU_LOADOP_DONT_CARE;
+        cti.load_op = SDL_GPU_LOADOP_CLEAR;
         cti.store_op = SDL_GPU_STOREOP_STORE;
         cti.texture = textures[TEXTURE_RAY_POSITION_BACK];
         cti.cycle = true;
@@ -1013,9 +1374,21 @@ void renderer_composite()
             SDL_Log("Failed to begin render pass: %s", SDL_GetError());
             goto error;
         }
-        SDL_BindGPUGraphicsPipeline(pass, graphics[GRAPHICS_RAY_MODEL_BACK]);
-        SDL_PushGPUVertexUniformData(commands, 0, ray_camera.matrix, 64);
-        world_draw_models(device, pass, NULL);
+        SDL_GPUGraphicsPipeline* pipeline;
+        if (world_get_batched(WORLD_PASS_RAY_MODEL_BACK))
+        {
+            pipeline = get_graphics(GRAPHICS_RAY_BATCH_BACK);
+        }
+        else
+        {
+            pipeline = get_graphics(GRAPHICS_RAY_MODEL_BACK);
+        }
+        if (pipeline)
+        {
+            SDL_BindGPUGraphicsPipeline(pass, pipeline);
+            SDL_PushGPUVertexUniformData(commands, 0, ray_camera.matrix, 64);
+            world_draw_models(device, commands, pass, WORLD_PASS_RAY_MODEL_BACK, NULL);
+        }
         SDL_EndGPURenderPass(pass);
         SDL_PopGPUDebugGroup(commands);
     }
@@ -1034,15 +1407,30 @@ void renderer_composite()
             SDL_Log("Failed to begin render pass: %s", SDL_GetError());
             goto error;
         }
-        SDL_BindGPUGraphicsPipeline(pass, graphics[GRAPHICS_SUN_MODEL]);
-        SDL_PushGPUVertexUniformData(commands, 0, sun_camera.matrix, 64);
-        world_draw_models(device, pass, NULL);
+        SDL_GPUGraphicsPipeline* pipeline;
+        if (world_get_batched(WORLD_PASS_SUN_MODEL))
+        {
+            pipeline = get_graphics(GRAPHICS_SUN_BATCH);
+        }
+        else
+        {
+            pipeline = get_graphics(GRAPHICS_SUN_MODEL);
+        }
+        if (pipeline)
+        {
+            SDL_BindGPUGraphicsPipeline(pass, pipeline);
+            SDL_PushGPUVertexUniformData(commands, 0, sun_camera.matrix, 64);
+            world_draw_models(device, commands, pass, WORLD_PASS_SUN_MODEL, NULL);
+        }
         SDL_EndGPURenderPass(pass);
         SDL_PopGPUDebugGroup(commands);
     }
     {
         SDL_PushGPUDebugGroup(commands, "light");
+        SDL_GPUGraphicsPipeline* pipeline = get_graphics(GRAPHICS_LIGHT);
         SDL_GPUColorTargetInfo cti = {0};
+        /* fully lit rather than black until the pipeline arrives */
+        cti.clear_color.r = pipeline ? 0.0f : 1.0f;
         cti.load_op = SDL_GPU_LOADOP_CLEAR;
         cti.store_op = SDL_GPU_STOREOP_STORE;
         cti.texture = textures[TEXTURE_LIGHT];
@@ -1066,12 +1454,15 @@ void renderer_composite()
         tsb[3].texture = textures[TEXTURE_RAY_POSITION_BACK];
         tsb[4].sampler = samplers[SAMPLER_NEAREST];
         tsb[4].texture = textures[TEXTURE_SUN_DEPTH];
-        SDL_BindGPUGraphicsPipeline(pass, graphics[GRAPHICS_LIGHT]);
-        SDL_BindGPUFragmentSamplers(pass, 0, tsb, 5);
-        SDL_PushGPUFragmentUniformData(commands, 0, ray_camera.matrix, 64);
-        SDL_PushGPUFragmentUniformData(commands, 1, sun_camera.matrix, 64);
-        SDL_PushGPUFragmentUniformData(commands, 2, sun, sizeof(sun));
-        world_draw_lights(device, commands, pass);
+        if (pipeline)
+        {
+            SDL_BindGPUGraphicsPipeline(pass, pipeline);
+            SDL_BindGPUFragmentSamplers(pass, 0, tsb, 5);
+            SDL_PushGPUFragmentUniformData(commands, 0, ray_camera.matrix, 64);
+            SDL_PushGPUFragmentUniformData(commands, 1, sun_camera.matrix, 64);
+            SDL_PushGPUFragmentUniformData(commands, 2, sun, sizeof(sun));
+            world_draw_lights(device, commands, pass);
+        }
         SDL_EndGPURenderPass(pass);
         SDL_PopGPUDebugGroup(commands);
     }
@@ -1097,7 +1488,7 @@ void renderer_composite()
         tsb[2].texture = textures[TEXTURE_NORMAL];
         tsb[3].sampler = samplers[SAMPLER_NEAREST];
         tsb[3].texture = textures[TEXTURE_LIGHT];
-        SDL_BindGPUGraphicsPipeline(pass, graphics[GRAPHICS_COMPOSITE]);
+        SDL_BindGPUGraphicsPipeline(pass, get_graphics(GRAPHICS_COMPOSITE));
         SDL_BindGPUFragmentSamplers(pass, 0, tsb, 4);
         SDL_DrawGPUPrimitives(pass, 4, 1, 0, 0);
         SDL_EndGPURenderPass(pass);
@@ -1181,4 +1572,86 @@ void renderer_get_bounds(
     *z1 = ray_camera.z - ray_camera.height;
     *x2 = ray_camera.x + ray_camera.width;
     *z2 = ray_camera.z + ray_camera.height;
+}
+
+int renderer_get_polygon(
+    float polygon[CAMERA_MAX_POLYGON][2])
+{
+    assert(polygon);
+    return camera_get_polygon(&camera, polygon);
+}
+
+void renderer_get_sun(
+    float* x,
+    float* y,
+    float* z)
+{
+    assert(x);
+    assert(y);
+    assert(z);
+    camera_get_vector(&sun_camera, x, y, z);
+}
+
+renderer_state_t renderer_get_state()
+{
+    return SDL_GetAtomicInt(&state);
+}
+
+void renderer_wait()
+{
+    if (thread)
+    {
+        SDL_WaitThread(thread, NULL);
+        thread = NULL;
+    }
+}
+
+bool renderer_set_quality(
+    const int value)
+{
+    assert(value >= 0 && value < QUALITY_COUNT);
+    renderer_wait();
+    if (value == quality)
+    {
+        return true;
+    }
+    /* the pair is only swapped once both exist, so a failure leaves the old
+    one drawing */
+    const int indices[] = { GRAPHICS_LIGHT, GRAPHICS_COMPOSITE };
+    SDL_GPUGraphicsPipeline* pipelines[2];
+    if (!create_pipelines(indices, 2, value, pipelines))
+    {
+        SDL_Log("Failed to set quality: %s", qualities[value]);
+        for (int i = 0; i < 2; i++)
+        {
+            if (pipelines[i])
+            {
+                SDL_ReleaseGPUGraphicsPipeline(device, pipelines[i]);
+            }
+        }
+        return false;
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        SDL_GPUGraphicsPipeline* previous = get_graphics(indices[i]);
+        SDL_SetAtomicPointer((void**) &graphics[indices[i]], pipelines[i]);
+        if (previous)
+        {
+            SDL_ReleaseGPUGraphicsPipeline(device, previous);
+        }
+    }
+    quality = value;
+    return true;
+}
+
+int renderer_get_quality()
+{
+    return quality;
+}
+
+const char* renderer_get_quality_str(
+    const int value)
+{
+    assert(value >= 0 && value < QUALITY_COUNT);
+    return qualities[value];
 }
\ No newline at end of file
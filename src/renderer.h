@@ -2,8 +2,17 @@
 
 #include <SDL3/SDL.h>
 #include <stdbool.h>
+#include "camera.h"
 #include "model.h"
 
+typedef enum
+{
+    RENDERER_STATE_LOADING,
+    RENDERER_STATE_LOADED,
+    RENDERER_STATE_FAILED,
+}
+renderer_state_t;
+
 bool renderer_init(
     SDL_Window* window,
     SDL_GPUDevice* device);
@@ -27,4 +36,17 @@ void renderer_get_bounds(
     float* x1,
     float* z1,
     float* x2,
-    float* z2);
\ No newline at end of file
+    float* z2);
+int renderer_get_polygon(
+    float polygon[CAMERA_MAX_POLYGON][2]);
+void renderer_get_sun(
+    float* x,
+    float* y,
+    float* z);
+renderer_state_t renderer_get_state();
+void renderer_wait();
+bool renderer_set_quality(
+    const int quality);
+int renderer_get_quality();
+const char* renderer_get_quality_str(
+    const int quality);
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include <SDL3/SDL.h>
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "config.h"
+#include "helpers.h"
+#include "stats.h"
+
+static int64_t values[STATS_COUNT];
+static uint64_t ticks;
+static int frames;
+
+void stats_add(
+    const stats_t stats,
+    const int64_t value)
+{
+    assert(stats < STATS_COUNT);
+    values[stats] += value;
+}
+
+void stats_update()
+{
+    frames++;
+    const uint64_t now = SDL_GetTicks();
+    if (now - ticks < STATS_INTERVAL)
+    {
+        return;
+    }
+    const char* names[STATS_COUNT] =
+    {
+#define X(name) #name,
+        STATS
+#undef X
+    };
+    /* logging is opt in, the counters reset either way */
+    for (stats_t stats = 0; STATS_LOG && stats < STATS_COUNT; stats++)
+    {
+        char str[256] = {0};
+        for (size_t i = 0; i < sizeof(str) - 1 && names[stats][i]; i++)
+        {
+            str[i] = tolower(names[stats][i]);
+        }
+        SDL_Log("%s: %.1f", str, (double) values[stats] / frames);
+    }
+    memset(values, 0, sizeof(values));
+    ticks = now;
+    frames = 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+#define STATS \
+    X(MODEL_CULLED) \
+    X(RAY_MODEL_FRONT_CULLED) \
+    X(RAY_MODEL_BACK_CULLED) \
+    X(SUN_MODEL_CULLED) \
+    X(MODEL_TRIANGLES) \
+    X(RAY_MODEL_FRONT_TRIANGLES) \
+    X(RAY_MODEL_BACK_TRIANGLES) \
+    X(SUN_MODEL_TRIANGLES) \
+    X(MASKED_TRIANGLES) \
+    X(ROWS_FETCHED) \
+
+typedef enum
+{
+#define X(name) STATS_##name,
+    STATS
+#undef X
+    STATS_COUNT,
+}
+stats_t;
+
+void stats_add(
+    const stats_t stats,
+    const int64_t value);
+void stats_update();
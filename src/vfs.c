@@ -0,0 +1,141 @@
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "helpers.h"
+#include "pack.h"
+#include "vfs.h"
+
+static uint8_t* mapping;
+static size_t mapping_size;
+static const pack_entry_t* entries;
+static int num_entries;
+
+bool vfs_init(
+    const char* pack)
+{
+    assert(pack);
+    /* without a pack everything is read from loose files */
+    mapping = map_file(pack, &mapping_size);
+    if (!mapping)
+    {
+        SDL_Log("Failed to map pack, using loose files: %s", pack);
+        return true;
+    }
+    const pack_header_t* header = (const pack_header_t*) mapping;
+    if (mapping_size < sizeof(pack_header_t) ||
+        header->magic != PACK_MAGIC ||
+        header->version != PACK_VERSION ||
+        header->num_entries > (mapping_size - sizeof(pack_header_t)) / sizeof(pack_entry_t))
+    {
+        SDL_Log("Failed to validate pack: %s", pack);
+        vfs_free();
+        return false;
+    }
+    entries = (const pack_entry_t*) (mapping + sizeof(pack_header_t));
+    num_entries = header->num_entries;
+    for (int i = 0; i < num_entries; i++)
+    {
+        const pack_entry_t* entry = &entries[i];
+        if (!memchr(entry->name, 0, PACK_NAME_SIZE) ||
+            entry->offset % PACK_ALIGNMENT ||
+            entry->offset > mapping_size ||
+            entry->size > mapping_size - entry->offset ||
+            (i > 0 && strcmp(entries[i - 1].name, entry->name) >= 0))
+        {
+            SDL_Log("Failed to validate pack: %s", pack);
+            vfs_free();
+            return false;
+        }
+    }
+    /* everything is read during startup so fault it in ahead of the loaders */
+    prefetch_file(mapping, mapping_size);
+    return true;
+}
+
+void vfs_free()
+{
+    unmap_file(mapping, mapping_size);
+    mapping = NULL;
+    mapping_size = 0;
+    entries = NULL;
+    num_entries = 0;
+}
+
+static const pack_entry_t* find(
+    const char* file)
+{
+    int low = 0;
+    int high = num_entries - 1;
+    while (low <= high)
+    {
+        const int mid = (low + high) / 2;
+        const int order = strcmp(entries[mid].name, file);
+        if (!order)
+        {
+            return &entries[mid];
+        }
+        if (order < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid - 1;
+        }
+    }
+    return NULL;
+}
+
+const void* vfs_map(
+    const char* file,
+    size_t* size)
+{
+    assert(file);
+    assert(size);
+    const pack_entry_t* entry = find(file);
+    if (entry)
+    {
+        *size = entry->size;
+        return mapping + entry->offset;
+    }
+    return map_file(file, size);
+}
+
+void vfs_unmap(
+    const void* data,
+    const size_t size)
+{
+    /* blobs live in the pack mapping and stay until vfs_free */
+    const uint8_t* file = data;
+    if (mapping && file >= mapping && file <= mapping + mapping_size)
+    {
+        return;
+    }
+    unmap_file((void*) data, size);
+}
+
+bool vfs_get_info(
+    const char* file,
+    vfs_info_t* info)
+{
+    assert(file);
+    assert(info);
+    const pack_entry_t* entry = find(file);
+    if (entry)
+    {
+        info->stamp = entry->hash;
+        info->size = entry->size;
+        return true;
+    }
+    SDL_PathInfo path;
+    if (!SDL_GetPathInfo(file, &path))
+    {
+        return false;
+    }
+    info->stamp = path.modify_time;
+    info->size = path.size;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+    int64_t stamp;
+    uint64_t size;
+}
+vfs_info_t;
+
+bool vfs_init(
+    const char* pack);
+void vfs_free();
+const void* vfs_map(
+    const char* file,
+    size_t* size);
+void vfs_unmap(
+    const void* data,
+    const size_t size);
+bool vfs_get_info(
+    const char* file,
+    vfs_info_t* info);
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include <SDL3/SDL.h>
 #include <math.h>
+#include <stb_ds.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -9,81 +10,1759 @@
 #include "database.h"
 #include "helpers.h"
 #include "model.h"
+#include "pool.h"
+#include "stats.h"
 #include "world.h"
 
-static model_t* models;
-static SDL_GPUTransferBuffer* tbos[MODEL_COUNT];
-static SDL_GPUBuffer* vbos[MODEL_COUNT];
-static int max_instances[MODEL_COUNT];
-static int instances[MODEL_COUNT];
-static SDL_GPUTransferBuffer* light_tbo;
-static SDL_GPUBuffer* light_sbo;
+/* tiles are two bytes each and stored in chunk sized blocks so that scanning
+a chunk walks a few contiguous cache lines instead of one row per column */
+typedef uint16_t tile_t;
+#define BLOCK_SIZE (WORLD_CHUNK_SIZE * WORLD_CHUNK_SIZE)
+
+/* ids are handed out in order, so the low bits spread them over a table with
+room for twice the models a block can hold */
+#define RANGE_TABLE_SIZE (BLOCK_SIZE * 2)
+
+/* the instances of one model in a chunk. chunks only hold ranges for the
+models they contain, so nothing is sized by the number of registered models.
+they're slices of one shared array rather than a block sized array each */
+typedef struct
+{
+    model_t model;
+    int count;
+    int offset;
+}
+range_t;
+
+typedef struct
+{
+    int x;
+    int z;
+    int height;
+    int first_range;
+    int num_ranges;
+    int max_ranges;
+    int light_offset;
+    int light_count;
+    bool viewed;
+    bool shading;
+    bool edited;
+    bool visible[WORLD_PASS_COUNT];
+}
+chunk_t;
+
+typedef struct
+{
+    int x1;
+    int z1;
+    int x2;
+    int z2;
+    bool viewed;
+    bool shading;
+    bool dirty;
+    bool ground_pending;
+    bool batch_pending;
+    vertex_t* vertices;
+    uint32_t* indices;
+    int num_vertices;
+    int num_indices;
+    range_t* grounds;
+    int num_grounds;
+    int vertex_offset;
+    int first_index;
+    float* positions;
+    uint32_t* batch_indices;
+    int num_positions;
+    int num_batch_indices;
+    int position_offset;
+    int first_batch_index;
+}
+cache_t;
+
+typedef struct
+{
+    int x;
+    int z;
+}
+edit_t;
+
+/* a model present somewhere in the window and where its spans start */
+typedef struct
+{
+    model_t model;
+    int count;
+    int next;
+    int first_span;
+    int num_spans;
+}
+type_t;
+
+/* the range of a type in one chunk, spans of a type are in chunk order */
+typedef struct
+{
+    int chunk;
+    int offset;
+    int count;
+}
+span_t;
+
+typedef struct
+{
+    SDL_GPUTransferBuffer* tbo;
+    SDL_GPUBuffer* vbo;
+    SDL_GPUBuffer* ibo;
+    int num_vertices;
+    int num_indices;
+    int max_vertices;
+    int max_indices;
+}
+mesh_t;
+
+/* a gpu buffer with its contents kept on the cpu, so that an update only has
+to upload the elements from first to last that changed */
+typedef struct
+{
+    SDL_GPUTransferBuffer* tbo;
+    SDL_GPUBuffer* buffer;
+    uint8_t* data;
+    int capacity;
+    int first;
+    int last;
+}
+buffer_t;
+
+/* instances or lights of an untouched chunk that shifted during a patch */
+typedef struct
+{
+    int from;
+    int to;
+    int count;
+}
+move_t;
+
+static tile_t* tiles;
+static int bwidth;
+static int bheight;
+static chunk_t* chunks;
+static cache_t* caches;
+static range_t* shared_ranges;
+static int max_shared_ranges;
+static SDL_AtomicInt next_range;
+static int num_chunks;
+static int max_chunks;
+static int cx;
+static int cz;
+static int cwidth;
+static int cheight;
+static mesh_t ground_mesh;
+static mesh_t batch_mesh;
+static buffer_t instance_buffer;
+static type_t* types;
+static type_t* old_types;
+static span_t* spans;
+static span_t* old_spans;
+static int* lookup;
+static int max_lookup;
+static int num_ground_draws;
+static int num_instances;
+static SDL_GPUTransferBuffer* draw_tbos[WORLD_PASS_COUNT];
+static SDL_GPUBuffer* draw_ibos[WORLD_PASS_COUNT];
+static int max_draws[WORLD_PASS_COUNT];
+static int first_batches[WORLD_PASS_COUNT];
+static int num_batches[WORLD_PASS_COUNT];
+static bool batched[WORLD_PASS_COUNT] =
+{
+    [WORLD_PASS_RAY_MODEL_FRONT] = WORLD_BATCH_RAY,
+    [WORLD_PASS_RAY_MODEL_BACK] = WORLD_BATCH_RAY,
+    [WORLD_PASS_SUN_MODEL] = WORLD_BATCH_SUN,
+};
+static int num_instanced[WORLD_PASS_COUNT];
+static int num_grounds[WORLD_PASS_COUNT];
+static float view[CAMERA_MAX_POLYGON][2];
+static int num_view;
+static float sun[3] = { 0.0f, -1.0f, 0.0f };
+static float shade[4];
+static buffer_t light_buffer;
 static uint32_t lights;
-static int max_lights;
 static int wwidth;
 static int wheight;
 static int wx;
 static int wz;
 static bool dirty;
+static bool edited;
+static struct
+{
+    edit_t key;
+    model_t value;
+}
+*edits;
+
+/* the window is a ring buffer of blocks: tiles live at their world coordinates
+modulo the padded window size so that scrolling only has to replace the entering
+strips and every chunk maps onto exactly one block */
+static int get_index(
+    const int x,
+    const int z)
+{
+    const int width = bwidth * WORLD_CHUNK_SIZE;
+    const int height = bheight * WORLD_CHUNK_SIZE;
+    const int a = ((x % width) + width) % width;
+    const int b = ((z % height) + height) % height;
+    const int block = (b / WORLD_CHUNK_SIZE) * bwidth + a / WORLD_CHUNK_SIZE;
+    return block * BLOCK_SIZE + (a % WORLD_CHUNK_SIZE) * WORLD_CHUNK_SIZE + b % WORLD_CHUNK_SIZE;
+}
+
+static const tile_t* get_block(
+    const chunk_t* chunk)
+{
+    return &tiles[get_index(chunk->x * WORLD_CHUNK_SIZE, chunk->z * WORLD_CHUNK_SIZE)];
+}
+
+static range_t* get_ranges(
+    const chunk_t* chunk)
+{
+    return &shared_ranges[chunk->first_range];
+}
+
+model_t world_get_model(
+    const int x,
+    const int z)
+{
+    const int a = x - wx;
+    const int b = z - wz;
+    if (a < 0 || b < 0 || a >= wwidth || b >= wheight)
+    {
+        return MODEL_NONE;
+    }
+    return tiles[get_index(x, z)];
+}
+
+static void set_model(
+    const model_t model,
+    const int x,
+    const int z)
+{
+    const int a = x - wx;
+    const int b = z - wz;
+    if (a < 0 || b < 0 || a >= wwidth || b >= wheight)
+    {
+        return;
+    }
+    tiles[get_index(x, z)] = model;
+}
+
+static void load_model(
+    const model_t model,
+    const int x,
+    const int z)
+{
+    /* rows of models since dropped from the manifest stay empty */
+    if (model < model_get_count())
+    {
+        set_model(model, x, z);
+    }
+    stats_add(STATS_ROWS_FETCHED, 1);
+}
+
+static void load(
+    const int x1,
+    const int z1,
+    const int x2,
+    const int z2)
+{
+    if (x1 >= x2 || z1 >= z2)
+    {
+        return;
+    }
+    for (int x = x1; x < x2; x++)
+    {
+        for (int z = z1; z < z2; z++)
+        {
+            tiles[get_index(x, z)] = 0;
+        }
+    }
+    database_get_models(load_model, x1, z1, x2 - 1, z2 - 1);
+}
+
+/* flat ground slabs aren't instanced, each chunk merges them into one mesh */
+static bool is_ground(
+    const model_t model)
+{
+    return model_get_slab(model) && model_get_passes(model) == MODEL_PASS_MODEL;
+}
+
+/* occluders can be baked into one static mesh per chunk instead */
+static bool is_occluder(
+    const model_t model)
+{
+    return !is_ground(model) && model_get_passes(model) & (MODEL_PASS_RAY | MODEL_PASS_SUN);
+}
+
+/* the main pass only needs the view polygon and the occlusion passes only
+the smaller area that can shade it, so models are dropped outside of both */
+static bool is_hidden(
+    const chunk_t* chunk,
+    const model_t model)
+{
+    const int passes = model_get_passes(model);
+    if (chunk->viewed && passes & MODEL_PASS_MODEL)
+    {
+        return false;
+    }
+    return !chunk->shading || !(passes & (MODEL_PASS_RAY | MODEL_PASS_SUN));
+}
+
+static bool is_batching()
+{
+    for (world_pass_t pass = 0; pass < WORLD_PASS_COUNT; pass++)
+    {
+        if (batched[pass])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void get_chunk_bounds(
+    const chunk_t* chunk,
+    int* x1,
+    int* z1,
+    int* x2,
+    int* z2)
+{
+    *x1 = max(chunk->x * WORLD_CHUNK_SIZE, wx);
+    *z1 = max(chunk->z * WORLD_CHUNK_SIZE, wz);
+    *x2 = min((chunk->x + 1) * WORLD_CHUNK_SIZE, wx + wwidth);
+    *z2 = min((chunk->z + 1) * WORLD_CHUNK_SIZE, wz + wheight);
+}
+
+static bool is_viewed(
+    const chunk_t* chunk)
+{
+    if (!num_view)
+    {
+        return true;
+    }
+    int x1;
+    int z1;
+    int x2;
+    int z2;
+    get_chunk_bounds(chunk, &x1, &z1, &x2, &z2);
+    return camera_intersect_polygon(
+        view,
+        num_view,
+        x1 * MODEL_SIZE - MODEL_SIZE / 2.0f,
+        z1 * MODEL_SIZE - MODEL_SIZE / 2.0f,
+        x2 * MODEL_SIZE - MODEL_SIZE / 2.0f,
+        z2 * MODEL_SIZE - MODEL_SIZE / 2.0f);
+}
+
+/* lights and occluders matter as long as they can reach into the view */
+static bool is_shading(
+    const chunk_t* chunk)
+{
+    if (!num_view)
+    {
+        return true;
+    }
+    int x1;
+    int z1;
+    int x2;
+    int z2;
+    get_chunk_bounds(chunk, &x1, &z1, &x2, &z2);
+    return x2 * MODEL_SIZE - MODEL_SIZE / 2.0f >= shade[0] &&
+        z2 * MODEL_SIZE - MODEL_SIZE / 2.0f >= shade[1] &&
+        x1 * MODEL_SIZE - MODEL_SIZE / 2.0f <= shade[2] &&
+        z1 * MODEL_SIZE - MODEL_SIZE / 2.0f <= shade[3];
+}
+
+/* the bounds of the view grown by the farthest light spread, then stretched
+toward the sun by the longest shadow */
+static void update_shade()
+{
+    if (!num_view)
+    {
+        return;
+    }
+    shade[0] = view[0][0];
+    shade[1] = view[0][1];
+    shade[2] = view[0][0];
+    shade[3] = view[0][1];
+    for (int i = 1; i < num_view; i++)
+    {
+        shade[0] = min(shade[0], view[i][0]);
+        shade[1] = min(shade[1], view[i][1]);
+        shade[2] = max(shade[2], view[i][0]);
+        shade[3] = max(shade[3], view[i][1]);
+    }
+    const float spread = model_get_max_spread();
+    shade[0] -= spread;
+    shade[1] -= spread;
+    shade[2] += spread;
+    shade[3] += spread;
+    const float length = MODEL_MAX_HEIGHT / max(-sun[1], 0.01f);
+    const float dx = -sun[0] * length;
+    const float dz = -sun[2] * length;
+    shade[dx < 0.0f ? 0 : 2] += dx;
+    shade[dz < 0.0f ? 1 : 3] += dz;
+}
+
+static void free_cache(
+    cache_t* cache)
+{
+    free(cache->vertices);
+    free(cache->indices);
+    free(cache->positions);
+    free(cache->batch_indices);
+    free(cache->grounds);
+    cache->vertices = NULL;
+    cache->indices = NULL;
+    cache->positions = NULL;
+    cache->batch_indices = NULL;
+    cache->grounds = NULL;
+    cache->num_vertices = 0;
+    cache->num_indices = 0;
+    cache->num_positions = 0;
+    cache->num_batch_indices = 0;
+    cache->num_grounds = 0;
+}
+
+static void free_mesh(
+    SDL_GPUDevice* device,
+    mesh_t* mesh)
+{
+    if (mesh->tbo)
+    {
+        SDL_ReleaseGPUTransferBuffer(device, mesh->tbo);
+        mesh->tbo = NULL;
+    }
+    if (mesh->vbo)
+    {
+        SDL_ReleaseGPUBuffer(device, mesh->vbo);
+        mesh->vbo = NULL;
+    }
+    if (mesh->ibo)
+    {
+        SDL_ReleaseGPUBuffer(device, mesh->ibo);
+        mesh->ibo = NULL;
+    }
+    mesh->max_vertices = 0;
+    mesh->max_indices = 0;
+}
+
+/* grows the buffers when needed, which loses what they held */
+static bool reserve_mesh(
+    SDL_GPUDevice* device,
+    mesh_t* mesh,
+    const int stride,
+    bool* grown)
+{
+    *grown = false;
+    if (mesh->num_vertices <= mesh->max_vertices && mesh->num_indices <= mesh->max_indices)
+    {
+        return true;
+    }
+    free_mesh(device, mesh);
+    SDL_GPUTransferBufferCreateInfo tbci = {0};
+    tbci.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+    tbci.size = mesh->num_vertices * stride + mesh->num_indices * sizeof(uint32_t);
+    mesh->tbo = SDL_CreateGPUTransferBuffer(device, &tbci);
+    SDL_GPUBufferCreateInfo bci = {0};
+    bci.usage = SDL_GPU_BUFFERUSAGE_VERTEX;
+    bci.size = mesh->num_vertices * stride;
+    mesh->vbo = SDL_CreateGPUBuffer(device, &bci);
+    bci.usage = SDL_GPU_BUFFERUSAGE_INDEX;
+    bci.size = mesh->num_indices * sizeof(uint32_t);
+    mesh->ibo = SDL_CreateGPUBuffer(device, &bci);
+    if (!mesh->tbo || !mesh->vbo || !mesh->ibo)
+    {
+        SDL_Log("Failed to create buffer(s): %s", SDL_GetError());
+        free_mesh(device, mesh);
+        return false;
+    }
+    mesh->max_vertices = mesh->num_vertices;
+    mesh->max_indices = mesh->num_indices;
+    *grown = true;
+    return true;
+}
+
+/* the transfer buffer holds the vertices from first_vertex followed by the
+indices from first_index. a partial upload keeps the rest of the buffers, so
+only a full one may cycle them */
+static void upload_mesh(
+    SDL_GPUDevice* device,
+    SDL_GPUCopyPass* copy,
+    mesh_t* mesh,
+    const int stride,
+    const int first_vertex,
+    const int last_vertex,
+    const int first_index,
+    const int last_index)
+{
+    SDL_UnmapGPUTransferBuffer(device, mesh->tbo);
+    SDL_GPUTransferBufferLocation location = {0};
+    SDL_GPUBufferRegion region = {0};
+    location.transfer_buffer = mesh->tbo;
+    if (last_vertex > first_vertex)
+    {
+        region.buffer = mesh->vbo;
+        region.offset = first_vertex * stride;
+        region.size = (last_vertex - first_vertex) * stride;
+        SDL_UploadToGPUBuffer(copy, &location, &region, !first_vertex && last_vertex == mesh->num_vertices);
+    }
+    if (last_index > first_index)
+    {
+        location.offset = (last_vertex - first_vertex) * stride;
+        region.buffer = mesh->ibo;
+        region.offset = first_index * sizeof(uint32_t);
+        region.size = (last_index - first_index) * sizeof(uint32_t);
+        SDL_UploadToGPUBuffer(copy, &location, &region, !first_index && last_index == mesh->num_indices);
+    }
+}
+
+static void free_buffer(
+    SDL_GPUDevice* device,
+    buffer_t* buffer)
+{
+    if (buffer->tbo)
+    {
+        SDL_ReleaseGPUTransferBuffer(device, buffer->tbo);
+        buffer->tbo = NULL;
+    }
+    if (buffer->buffer)
+    {
+        SDL_ReleaseGPUBuffer(device, buffer->buffer);
+        buffer->buffer = NULL;
+    }
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->capacity = 0;
+    buffer->first = 0;
+    buffer->last = 0;
+}
+
+static void mark_buffer(
+    buffer_t* buffer,
+    const int first,
+    const int last)
+{
+    if (first >= last)
+    {
+        return;
+    }
+    if (buffer->first >= buffer->last)
+    {
+        buffer->first = first;
+        buffer->last = last;
+        return;
+    }
+    buffer->first = min(buffer->first, first);
+    buffer->last = max(buffer->last, last);
+}
+
+/* the cpu copy keeps its contents when it grows but the gpu buffer is new, so
+all of it goes up again */
+static bool reserve_buffer(
+    SDL_GPUDevice* device,
+    buffer_t* buffer,
+    const int count,
+    const int stride,
+    const SDL_GPUBufferUsageFlags usage)
+{
+    if (count <= buffer->capacity)
+    {
+        return true;
+    }
+    uint8_t* data = realloc(buffer->data, count * stride);
+    if (!data)
+    {
+        SDL_Log("Failed to allocate buffer");
+        return false;
+    }
+    buffer->data = data;
+    buffer->capacity = 0;
+    if (buffer->tbo)
+    {
+        SDL_ReleaseGPUTransferBuffer(device, buffer->tbo);
+        buffer->tbo = NULL;
+    }
+    if (buffer->buffer)
+    {
+        SDL_ReleaseGPUBuffer(device, buffer->buffer);
+        buffer->buffer = NULL;
+    }
+    SDL_GPUTransferBufferCreateInfo tbci = {0};
+    tbci.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+    tbci.size = count * stride;
+    buffer->tbo = SDL_CreateGPUTransferBuffer(device, &tbci);
+    SDL_GPUBufferCreateInfo bci = {0};
+    bci.usage = usage;
+    bci.size = count * stride;
+    buffer->buffer = SDL_CreateGPUBuffer(device, &bci);
+    if (!buffer->tbo || !buffer->buffer)
+    {
+        SDL_Log("Failed to create buffer(s): %s", SDL_GetError());
+        return false;
+    }
+    buffer->capacity = count;
+    buffer->first = 0;
+    buffer->last = count;
+    return true;
+}
+
+static bool upload_buffer(
+    SDL_GPUDevice* device,
+    SDL_GPUCopyPass* copy,
+    buffer_t* buffer,
+    const int count,
+    const int stride)
+{
+    const int first = buffer->first;
+    const int last = min(buffer->last, count);
+    if (first >= last)
+    {
+        buffer->first = 0;
+        buffer->last = 0;
+        return true;
+    }
+    uint8_t* data = SDL_MapGPUTransferBuffer(device, buffer->tbo, true);
+    if (!data)
+    {
+        SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
+        return false;
+    }
+    memcpy(data, buffer->data + first * stride, (last - first) * stride);
+    SDL_UnmapGPUTransferBuffer(device, buffer->tbo);
+    SDL_GPUTransferBufferLocation location = {0};
+    SDL_GPUBufferRegion region = {0};
+    location.transfer_buffer = buffer->tbo;
+    region.buffer = buffer->buffer;
+    region.offset = first * stride;
+    region.size = (last - first) * stride;
+    SDL_UploadToGPUBuffer(copy, &location, &region, !first && last == count);
+    buffer->first = 0;
+    buffer->last = 0;
+    return true;
+}
+
+/* edits apply to the tiles right away but reach the database once per update,
+with repeated edits of a tile collapsed into the last one */
+static void flush_edits()
+{
+    for (int i = 0; i < stbds_hmlen(edits); i++)
+    {
+        database_set_model(edits[i].value, edits[i].key.x, edits[i].key.z);
+    }
+    stbds_hmfree(edits);
+}
+
+void world_free(
+    SDL_GPUDevice* device)
+{
+    flush_edits();
+    SDL_aligned_free(tiles);
+    free(chunks);
+    free(shared_ranges);
+    for (int i = 0; caches && i < cwidth * cheight; i++)
+    {
+        free_cache(&caches[i]);
+    }
+    free(caches);
+    free_mesh(device, &ground_mesh);
+    free_mesh(device, &batch_mesh);
+    free_buffer(device, &instance_buffer);
+    free_buffer(device, &light_buffer);
+    for (world_pass_t pass = 0; pass < WORLD_PASS_COUNT; pass++)
+    {
+        if (draw_tbos[pass])
+        {
+            SDL_ReleaseGPUTransferBuffer(device, draw_tbos[pass]);
+            draw_tbos[pass] = NULL;
+        }
+        if (draw_ibos[pass])
+        {
+            SDL_ReleaseGPUBuffer(device, draw_ibos[pass]);
+            draw_ibos[pass] = NULL;
+        }
+    }
+    /* nothing draws anymore, so every model the window used is released */
+    for (int i = 0; i < stbds_arrlen(types); i++)
+    {
+        model_release(types[i].model);
+    }
+    stbds_arrfree(types);
+    stbds_arrfree(old_types);
+    stbds_arrfree(spans);
+    stbds_arrfree(old_spans);
+    free(lookup);
+    lookup = NULL;
+    max_lookup = 0;
+    num_ground_draws = 0;
+    memset(max_draws, 0, sizeof(max_draws));
+    memset(num_instanced, 0, sizeof(num_instanced));
+    memset(num_grounds, 0, sizeof(num_grounds));
+    num_instances = 0;
+    lights = 0;
+    memset(num_batches, 0, sizeof(num_batches));
+    ground_mesh.num_vertices = 0;
+    ground_mesh.num_indices = 0;
+    batch_mesh.num_vertices = 0;
+    batch_mesh.num_indices = 0;
+    tiles = NULL;
+    chunks = NULL;
+    caches = NULL;
+    shared_ranges = NULL;
+    max_shared_ranges = 0;
+    num_chunks = 0;
+    max_chunks = 0;
+    cwidth = 0;
+    cheight = 0;
+    wwidth = 0;
+    wheight = 0;
+    bwidth = 0;
+    bheight = 0;
+    dirty = true;
+    edited = false;
+    device = NULL;
+}
+
+static int find_range(
+    int16_t table[RANGE_TABLE_SIZE],
+    const range_t* ranges,
+    const model_t model)
+{
+    int index = model & (RANGE_TABLE_SIZE - 1);
+    while (table[index] != -1 && ranges[table[index]].model != model)
+    {
+        index = (index + 1) & (RANGE_TABLE_SIZE - 1);
+    }
+    return index;
+}
+
+static void count_tiles(
+    const chunk_t* chunk,
+    range_t ranges[BLOCK_SIZE],
+    int* num_ranges,
+    int* height,
+    int* light_count)
+{
+    const tile_t* block = get_block(chunk);
+    const int ox = chunk->x * WORLD_CHUNK_SIZE;
+    const int oz = chunk->z * WORLD_CHUNK_SIZE;
+    int16_t table[RANGE_TABLE_SIZE];
+    memset(table, -1, sizeof(table));
+    int x1;
+    int z1;
+    int x2;
+    int z2;
+    get_chunk_bounds(chunk, &x1, &z1, &x2, &z2);
+    for (int x = x1; x < x2; x++)
+    {
+        const tile_t* column = &block[(x - ox) * WORLD_CHUNK_SIZE];
+        int range = -1;
+        for (int z = z1; z < z2; z++)
+        {
+            /* neighbouring tiles mostly hold the same model */
+            const model_t model = column[z - oz];
+            if (range == -1 || ranges[range].model != model)
+            {
+                const int index = find_range(table, ranges, model);
+                if (table[index] == -1)
+                {
+                    table[index] = *num_ranges;
+                    ranges[*num_ranges].model = model;
+                    ranges[*num_ranges].count = 0;
+                    ranges[*num_ranges].offset = 0;
+                    (*num_ranges)++;
+                }
+                range = table[index];
+            }
+            ranges[range].count++;
+        }
+    }
+    /* lights and height only depend on which models are present */
+    for (int i = 0; i < *num_ranges; i++)
+    {
+        const model_t model = ranges[i].model;
+        *height = max(*height, model_get_height(model));
+        *light_count += model_get_spread(model) > 0 ? ranges[i].count : 0;
+    }
+}
+
+static void count_chunk(
+    void* data,
+    const int index)
+{
+    const bool* all = data;
+    chunk_t* chunk = &chunks[index];
+    if (!*all && !chunk->edited)
+    {
+        return;
+    }
+    range_t ranges[BLOCK_SIZE];
+    int num_ranges = 0;
+    chunk->height = 0;
+    chunk->light_count = 0;
+    count_tiles(chunk, ranges, &num_ranges, &chunk->height, &chunk->light_count);
+    if (!chunk->shading)
+    {
+        chunk->light_count = 0;
+    }
+    int count = 0;
+    for (int i = 0; i < num_ranges; i++)
+    {
+        if (!is_hidden(chunk, ranges[i].model))
+        {
+            ranges[count++] = ranges[i];
+        }
+    }
+    /* a chunk keeps its slice while the ranges fit and claims a new one at
+    the end of the array otherwise */
+    if (count > chunk->max_ranges)
+    {
+        chunk->first_range = SDL_AddAtomicInt(&next_range, count);
+        chunk->max_ranges = count;
+    }
+    chunk->num_ranges = count;
+    if (chunk->first_range + count <= max_shared_ranges)
+    {
+        memcpy(get_ranges(chunk), ranges, count * sizeof(range_t));
+    }
+}
+
+static bool reserve_ranges(
+    const int count)
+{
+    if (count <= max_shared_ranges)
+    {
+        return true;
+    }
+    /* headroom for the slices edits claim until the next full update */
+    const int capacity = count + count / 2;
+    range_t* ranges = realloc(shared_ranges, capacity * sizeof(range_t));
+    if (!ranges)
+    {
+        SDL_Log("Failed to allocate ranges");
+        return false;
+    }
+    shared_ranges = ranges;
+    max_shared_ranges = capacity;
+    return true;
+}
+
+/* every chunk or only the edited ones. chunks that claimed a slice past the
+end of the array keep it, so counting them again once it grew fills it in */
+static bool count_chunks(
+    bool all)
+{
+    if (all)
+    {
+        SDL_SetAtomicInt(&next_range, 0);
+        for (int i = 0; i < num_chunks; i++)
+        {
+            chunks[i].max_ranges = 0;
+        }
+    }
+    pool_run(count_chunk, &all, num_chunks);
+    const int count = SDL_GetAtomicInt(&next_range);
+    if (count <= max_shared_ranges)
+    {
+        return true;
+    }
+    if (!reserve_ranges(count))
+    {
+        return false;
+    }
+    pool_run(count_chunk, &all, num_chunks);
+    return true;
+}
+
+typedef struct
+{
+    range_t ranges[BLOCK_SIZE];
+    int num_ranges;
+    int height;
+    int light_count;
+}
+scan_t;
+
+static void scan_chunk(
+    void* data,
+    const int index)
+{
+    scan_t* scans = data;
+    scan_t* scan = &scans[index];
+    count_tiles(&chunks[index], scan->ranges, &scan->num_ranges, &scan->height, &scan->light_count);
+}
+
+int world_count(
+    int* counts)
+{
+    assert(counts);
+    memset(counts, 0, model_get_count() * sizeof(int));
+    if (!num_chunks)
+    {
+        return 0;
+    }
+    scan_t* scans = calloc(num_chunks, sizeof(scan_t));
+    if (!scans)
+    {
+        SDL_Log("Failed to allocate scans");
+        return 0;
+    }
+    pool_run(scan_chunk, scans, num_chunks);
+    int light_count = 0;
+    for (int i = 0; i < num_chunks; i++)
+    {
+        for (int j = 0; j < scans[i].num_ranges; j++)
+        {
+            counts[scans[i].ranges[j].model] += scans[i].ranges[j].count;
+        }
+        light_count += scans[i].light_count;
+    }
+    free(scans);
+    return light_count;
+}
+
+typedef struct
+{
+    int16_t* idata;
+    float* ldata;
+}
+fill_t;
+
+static void fill_chunk(
+    void* data,
+    const int index)
+{
+    const fill_t* fill = data;
+    const chunk_t* chunk = &chunks[index];
+    const tile_t* block = get_block(chunk);
+    const int ox = chunk->x * WORLD_CHUNK_SIZE;
+    const int oz = chunk->z * WORLD_CHUNK_SIZE;
+    const range_t* ranges = get_ranges(chunk);
+    int16_t table[RANGE_TABLE_SIZE];
+    memset(table, -1, sizeof(table));
+    int offsets[BLOCK_SIZE];
+    for (int i = 0; i < chunk->num_ranges; i++)
+    {
+        table[find_range(table, ranges, ranges[i].model)] = i;
+        offsets[i] = ranges[i].offset;
+    }
+    int light = chunk->light_offset;
+    int x1;
+    int z1;
+    int x2;
+    int z2;
+    get_chunk_bounds(chunk, &x1, &z1, &x2, &z2);
+    for (int x = x1; x < x2; x++)
+    {
+        const tile_t* column = &block[(x - ox) * WORLD_CHUNK_SIZE];
+        for (int z = z1; z < z2; z++)
+        {
+            const model_t model = column[z - oz];
+            if (!is_ground(model) && !is_hidden(chunk, model))
+            {
+                const int instance = offsets[table[find_range(table, ranges, model)]]++;
+                fill->idata[instance * 4 + 0] = x - wx;
+                fill->idata[instance * 4 + 1] = z - wz;
+                fill->idata[instance * 4 + 2] = model_get_layer(model);
+                fill->idata[instance * 4 + 3] = 0;
+            }
+            if (!chunk->shading || model_get_spread(model) <= 0)
+            {
+                continue;
+            }
+            fill->ldata[light * 4 + 0] = x * MODEL_SIZE;
+            fill->ldata[light * 4 + 1] = model_get_height(model);
+            fill->ldata[light * 4 + 2] = z * MODEL_SIZE;
+            fill->ldata[light * 4 + 3] = model_get_spread(model);
+            light++;
+        }
+    }
+    /* ground meshes are built relative to the chunk corner */
+    for (int i = 0; i < chunk->num_ranges; i++)
+    {
+        const range_t* range = &ranges[i];
+        if (is_ground(range->model))
+        {
+            fill->idata[range->offset * 4 + 0] = ox - wx;
+            fill->idata[range->offset * 4 + 1] = oz - wz;
+            fill->idata[range->offset * 4 + 2] = model_get_layer(range->model);
+            fill->idata[range->offset * 4 + 3] = 0;
+        }
+    }
+}
+
+static void get_ground_bounds(
+    const chunk_t* chunk,
+    int* x1,
+    int* z1,
+    int* x2,
+    int* z2)
+{
+    /* sides depend on the neighbouring tiles too */
+    *x1 = max(chunk->x * WORLD_CHUNK_SIZE - 1, wx);
+    *z1 = max(chunk->z * WORLD_CHUNK_SIZE - 1, wz);
+    *x2 = min((chunk->x + 1) * WORLD_CHUNK_SIZE + 1, wx + wwidth);
+    *z2 = min((chunk->z + 1) * WORLD_CHUNK_SIZE + 1, wz + wheight);
+}
+
+static int get_ground_height(
+    const int x,
+    const int z)
+{
+    const model_t model = world_get_model(x, z);
+    if (model == MODEL_NONE || !is_ground(model))
+    {
+        return 0;
+    }
+    return model_get_height(model);
+}
+
+static void add_quad(
+    cache_t* cache,
+    const int p[3],
+    const int u[3],
+    const int v[3],
+    const int normal,
+    const int palette)
+{
+    const int index = cache->num_vertices;
+    for (int i = 0; i < 4; i++)
+    {
+        const int a = i == 1 || i == 2;
+        const int b = i >= 2;
+        vertex_t* vertex = &cache->vertices[cache->num_vertices++];
+        vertex->x = p[0] + u[0] * a + v[0] * b;
+        vertex->y = p[1] + u[1] * a + v[1] * b;
+        vertex->z = p[2] + u[2] * a + v[2] * b;
+        vertex->data = normal << MODEL_NORMAL_SHIFT | palette;
+    }
+    const int offsets[6] = { 0, 1, 2, 0, 2, 3 };
+    for (int i = 0; i < 6; i++)
+    {
+        cache->indices[cache->num_indices++] = index + offsets[i];
+    }
+}
+
+static void add_side(
+    cache_t* cache,
+    const model_slab_t* slab,
+    const int bottom,
+    const int p[3],
+    const int run[3],
+    const int normal)
+{
+    /* keep the winding counter clockwise around the outward normal */
+    const bool flip = normal == MODEL_NORMAL_POSITIVE_X || normal == MODEL_NORMAL_NEGATIVE_Z;
+    for (int i = 0; i < slab->num_bands; i++)
+    {
+        const int y1 = max(slab->heights[i], bottom);
+        const int y2 = slab->heights[i + 1];
+        if (y2 <= y1)
+        {
+            continue;
+        }
+        const int q[3] = { p[0], y1, p[2] };
+        const int up[3] = { 0, y2 - y1, 0 };
+        if (flip)
+        {
+            add_quad(cache, q, up, run, normal, slab->palettes[i]);
+        }
+        else
+        {
+            add_quad(cache, q, run, up, normal, slab->palettes[i]);
+        }
+    }
+}
+
+static void mesh_ground(
+    const chunk_t* chunk,
+    cache_t* cache,
+    const model_t model)
+{
+    const model_slab_t* slab = model_get_slab(model);
+    const int height = model_get_height(model);
+    const int ox = chunk->x * WORLD_CHUNK_SIZE;
+    const int oz = chunk->z * WORLD_CHUNK_SIZE;
+    int x1;
+    int z1;
+    int x2;
+    int z2;
+    get_chunk_bounds(chunk, &x1, &z1, &x2, &z2);
+    const int width = x2 - x1;
+    const int depth = z2 - z1;
+    /* greedy quads over the tops */
+    bool used[WORLD_CHUNK_SIZE][WORLD_CHUNK_SIZE] = {0};
+    for (int b = 0; b < depth; b++)
+    {
+        for (int a = 0; a < width; a++)
+        {
+            if (used[b][a] || world_get_model(x1 + a, z1 + b) != model)
+            {
+                continue;
+            }
+            int w = 1;
+            while (a + w < width && !used[b][a + w] && world_get_model(x1 + a + w, z1 + b) == model)
+            {
+                w++;
+            }
+            int d = 1;
+            for (; b + d < depth; d++)
+            {
+                int i = 0;
+                while (i < w && !used[b + d][a + i] && world_get_model(x1 + a + i, z1 + b + d) == model)
+                {
+                    i++;
+                }
+                if (i < w)
+                {
+                    break;
+                }
+            }
+            for (int j = 0; j < d; j++)
+            {
+                for (int i = 0; i < w; i++)
+                {
+                    used[b + j][a + i] = true;
+                }
+            }
+            const int p[3] =
+            {
+                (x1 + a - ox) * MODEL_SIZE - MODEL_SIZE / 2,
+                height,
+                (z1 + b - oz) * MODEL_SIZE - MODEL_SIZE / 2,
+            };
+            const int u[3] = { 0, 0, d * MODEL_SIZE };
+            const int v[3] = { w * MODEL_SIZE, 0, 0 };
+            add_quad(cache, p, u, v, MODEL_NORMAL_POSITIVE_Y, slab->top);
+        }
+    }
+    /* sides only where the neighbour is lower, merged along each edge */
+    const int directions[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+    const int normals[4] =
+    {
+        MODEL_NORMAL_POSITIVE_X,
+        MODEL_NORMAL_NEGATIVE_X,
+        MODEL_NORMAL_POSITIVE_Z,
+        MODEL_NORMAL_NEGATIVE_Z,
+    };
+    for (int k = 0; k < 4; k++)
+    {
+        const int dx = directions[k][0];
+        const int dz = directions[k][1];
+        const int outer = dz ? depth : width;
+        const int inner = dz ? width : depth;
+        for (int i = 0; i < outer; i++)
+        {
+            int bottom = -1;
+            int first = 0;
+            for (int j = 0; j <= inner; j++)
+            {
+                int next = -1;
+                if (j < inner)
+                {
+                    const int x = x1 + (dz ? j : i);
+                    const int z = z1 + (dz ? i : j);
+                    if (world_get_model(x, z) == model)
+                    {
+                        next = get_ground_height(x + dx, z + dz);
+                        next = next < height ? next : -1;
+                    }
+                }
+                if (next == bottom)
+                {
+                    continue;
+                }
+                if (bottom != -1)
+                {
+                    const int x = x1 + (dz ? first : i) - ox;
+                    const int z = z1 + (dz ? i : first) - oz;
+                    const int n = j - first;
+                    const int p[3] =
+                    {
+                        x * MODEL_SIZE + (dx ? dx : -1) * MODEL_SIZE / 2,
+                        0,
+                        z * MODEL_SIZE + (dz ? dz : -1) * MODEL_SIZE / 2,
+                    };
+                    const int run[3] = { dz ? n * MODEL_SIZE : 0, 0, dz ? 0 : n * MODEL_SIZE };
+                    add_side(cache, slab, bottom, p, run, normals[k]);
+                }
+                bottom = next;
+                first = j;
+            }
+        }
+    }
+}
+
+static void build_ground(
+    const chunk_t* chunk,
+    cache_t* cache)
+{
+    const range_t* ranges = get_ranges(chunk);
+    int count = 0;
+    int num_grounds = 0;
+    for (int i = 0; i < chunk->num_ranges; i++)
+    {
+        if (is_ground(ranges[i].model))
+        {
+            count += ranges[i].count;
+            num_grounds++;
+        }
+    }
+    if (!count)
+    {
+        return;
+    }
+    /* worst case is a top and every band on every side for each tile */
+    const int quads = count * (1 + 4 * MODEL_MAX_BANDS);
+    cache->vertices = malloc(quads * 4 * sizeof(vertex_t));
+    cache->indices = malloc(quads * 6 * sizeof(uint32_t));
+    cache->grounds = malloc(num_grounds * sizeof(range_t));
+    if (!cache->vertices || !cache->indices || !cache->grounds)
+    {
+        SDL_Log("Failed to allocate ground");
+        free(cache->vertices);
+        free(cache->indices);
+        free(cache->grounds);
+        cache->vertices = NULL;
+        cache->indices = NULL;
+        cache->grounds = NULL;
+        cache->dirty = true;
+        return;
+    }
+    /* each ground range is the model and the indices it meshed to */
+    for (int i = 0; i < chunk->num_ranges; i++)
+    {
+        const model_t model = ranges[i].model;
+        if (!is_ground(model))
+        {
+            continue;
+        }
+        const int first = cache->num_indices;
+        mesh_ground(chunk, cache, model);
+        if (cache->num_indices == first)
+        {
+            continue;
+        }
+        range_t* ground = &cache->grounds[cache->num_grounds++];
+        ground->model = model;
+        ground->count = cache->num_indices - first;
+        ground->offset = first;
+    }
+    /* shrinking can't fail in practice but keep the old block if it does */
+    vertex_t* vertices = realloc(cache->vertices, cache->num_vertices * sizeof(vertex_t));
+    uint32_t* indices = realloc(cache->indices, cache->num_indices * sizeof(uint32_t));
+    cache->vertices = vertices ? vertices : cache->vertices;
+    cache->indices = indices ? indices : cache->indices;
+}
+
+static void build_batch(
+    const chunk_t* chunk,
+    cache_t* cache)
+{
+    if (!chunk->shading)
+    {
+        return;
+    }
+    /* positions are baked in world space so a chunk is one plain draw */
+    const range_t* ranges = get_ranges(chunk);
+    int num_positions = 0;
+    int num_indices = 0;
+    for (int i = 0; i < chunk->num_ranges; i++)
+    {
+        const model_t model = ranges[i].model;
+        if (is_occluder(model))
+        {
+            num_positions += ranges[i].count * model_get_num_positions(model);
+            num_indices += ranges[i].count * model_get_num_position_indices(model);
+        }
+    }
+    if (!num_indices)
+    {
+        return;
+    }
+    cache->positions = malloc(num_positions * sizeof(float) * 3);
+    cache->batch_indices = malloc(num_indices * sizeof(uint32_t));
+    if (!cache->positions || !cache->batch_indices)
+    {
+        SDL_Log("Failed to allocate batch");
+        free(cache->positions);
+        free(cache->batch_indices);
+        cache->positions = NULL;
+        cache->batch_indices = NULL;
+        cache->dirty = true;
+        return;
+    }
+    int x1;
+    int z1;
+    int x2;
+    int z2;
+    get_chunk_bounds(chunk, &x1, &z1, &x2, &z2);
+    const tile_t* block = get_block(chunk);
+    const int ox = chunk->x * WORLD_CHUNK_SIZE;
+    const int oz = chunk->z * WORLD_CHUNK_SIZE;
+    for (int x = x1; x < x2; x++)
+    {
+        const tile_t* column = &block[(x - ox) * WORLD_CHUNK_SIZE];
+        for (int z = z1; z < z2; z++)
+        {
+            const model_t model = column[z - oz];
+            if (!is_occluder(model))
+            {
+                continue;
+            }
+            const float* positions = model_get_positions(model);
+            const uint32_t* indices = model_get_position_indices(model);
+            const int first = cache->num_positions;
+            for (int i = 0; i < model_get_num_positions(model); i++)
+            {
+                float* position = &cache->positions[cache->num_positions++ * 3];
+                position[0] = positions[i * 3 + 0] + x * MODEL_SIZE;
+                position[1] = positions[i * 3 + 1];
+                position[2] = positions[i * 3 + 2] + z * MODEL_SIZE;
+            }
+            for (int i = 0; i < model_get_num_position_indices(model); i++)
+            {
+                cache->batch_indices[cache->num_batch_indices++] = first + indices[i];
+            }
+        }
+    }
+}
+
+static void build_chunk(
+    void* data,
+    const int index)
+{
+    const chunk_t* chunk = &chunks[index];
+    cache_t* cache = &caches[index];
+    int x1;
+    int z1;
+    int x2;
+    int z2;
+    get_ground_bounds(chunk, &x1, &z1, &x2, &z2);
+    if (!cache->dirty && cache->x1 == x1 && cache->z1 == z1 && cache->x2 == x2 && cache->z2 == z2 &&
+        cache->viewed == chunk->viewed && cache->shading == chunk->shading)
+    {
+        return;
+    }
+    free_cache(cache);
+    cache->x1 = x1;
+    cache->z1 = z1;
+    cache->x2 = x2;
+    cache->z2 = z2;
+    cache->viewed = chunk->viewed;
+    cache->shading = chunk->shading;
+    cache->dirty = false;
+    cache->ground_pending = true;
+    cache->batch_pending = true;
+    build_ground(chunk, cache);
+    if (is_batching())
+    {
+        build_batch(chunk, cache);
+    }
+}
+
+static int compare_types(
+    const void* a,
+    const void* b)
+{
+    return ((const type_t*) a)->model - ((const type_t*) b)->model;
+}
+
+/* instances are grouped by model and then by chunk so that each pass can
+cull chunks and still draw the visible ones in contiguous runs. only the models
+present get a type, so the cost follows the window rather than the registry.
+chunks are counted and filled in parallel and the offsets between them come
+from a prefix sum, so the output matches a serial walk */
+static bool update_types()
+{
+    const int count = model_get_count();
+    if (count > max_lookup)
+    {
+        int* next = realloc(lookup, count * sizeof(int));
+        if (!next)
+        {
+            SDL_Log("Failed to allocate lookup");
+            return false;
+        }
+        for (int i = max_lookup; i < count; i++)
+        {
+            next[i] = -1;
+        }
+        lookup = next;
+        max_lookup = count;
+    }
+    /* the previous types and spans stay around for patching */
+    type_t* previous = types;
+    types = old_types;
+    old_types = previous;
+    span_t* previous_spans = spans;
+    spans = old_spans;
+    old_spans = previous_spans;
+    stbds_arrsetlen(types, 0);
+    for (int i = 0; i < num_chunks; i++)
+    {
+        const chunk_t* chunk = &chunks[i];
+        const range_t* ranges = get_ranges(chunk);
+        for (int j = 0; j < chunk->num_ranges; j++)
+        {
+            const model_t model = ranges[j].model;
+            if (lookup[model] == -1)
+            {
+                const type_t type = { model };
+                lookup[model] = stbds_arrlen(types);
+                stbds_arrput(types, type);
+            }
+            types[lookup[model]].count += ranges[j].count;
+            types[lookup[model]].num_spans++;
+        }
+    }
+    qsort(types, stbds_arrlen(types), sizeof(type_t), compare_types);
+    num_instances = 0;
+    int num_spans = 0;
+    for (int i = 0; i < stbds_arrlen(types); i++)
+    {
+        type_t* type = &types[i];
+        lookup[type->model] = i;
+        type->next = num_instances;
+        type->first_span = num_spans;
+        num_instances += is_ground(type->model) ? type->num_spans : type->count;
+        num_spans += type->num_spans;
+        type->num_spans = 0;
+    }
+    stbds_arrsetlen(spans, num_spans);
+    for (int i = 0; i < num_chunks; i++)
+    {
+        const chunk_t* chunk = &chunks[i];
+        range_t* ranges = get_ranges(chunk);
+        for (int j = 0; j < chunk->num_ranges; j++)
+        {
+            range_t* range = &ranges[j];
+            type_t* type = &types[lookup[range->model]];
+            /* a ground range only needs the record that places its mesh */
+            range->offset = type->next;
+            type->next += is_ground(range->model) ? 1 : range->count;
+            span_t* span = &spans[type->first_span + type->num_spans++];
+            span->chunk = i;
+            span->offset = range->offset;
+            span->count = range->count;
+        }
+    }
+    /* models load on first reference and draw as placeholders until then,
+    the ones that left the window may give up their slot */
+    for (int i = 0; i < stbds_arrlen(types); i++)
+    {
+        model_request(types[i].model);
+    }
+    for (int i = 0; i < stbds_arrlen(old_types); i++)
+    {
+        if (lookup[old_types[i].model] == -1)
+        {
+            model_release(old_types[i].model);
+        }
+    }
+    for (int i = 0; i < stbds_arrlen(types); i++)
+    {
+        lookup[types[i].model] = -1;
+    }
+    return true;
+}
+
+/* caches that moved are uploaded again along with the rebuilt ones */
+static void layout_caches()
+{
+    num_ground_draws = 0;
+    ground_mesh.num_vertices = 0;
+    ground_mesh.num_indices = 0;
+    batch_mesh.num_vertices = 0;
+    batch_mesh.num_indices = 0;
+    for (int i = 0; i < num_chunks; i++)
+    {
+        cache_t* cache = &caches[i];
+        if (cache->vertex_offset != ground_mesh.num_vertices || cache->first_index != ground_mesh.num_indices)
+        {
+            cache->ground_pending = true;
+        }
+        if (cache->position_offset != batch_mesh.num_vertices || cache->first_batch_index != batch_mesh.num_indices)
+        {
+            cache->batch_pending = true;
+        }
+        cache->vertex_offset = ground_mesh.num_vertices;
+        cache->first_index = ground_mesh.num_indices;
+        cache->position_offset = batch_mesh.num_vertices;
+        cache->first_batch_index = batch_mesh.num_indices;
+        ground_mesh.num_vertices += cache->num_vertices;
+        ground_mesh.num_indices += cache->num_indices;
+        num_ground_draws += cache->num_grounds;
+        batch_mesh.num_vertices += cache->num_positions;
+        batch_mesh.num_indices += cache->num_batch_indices;
+    }
+}
+
+/* everything between the first and the last pending cache goes up in one
+region, the caches around it are already in place */
+static bool upload_ground(
+    SDL_GPUDevice* device,
+    SDL_GPUCopyPass* copy)
+{
+    int first = -1;
+    int last = -1;
+    for (int i = 0; i < num_chunks; i++)
+    {
+        if (caches[i].ground_pending && caches[i].num_vertices)
+        {
+            first = first == -1 ? i : first;
+            last = i;
+        }
+    }
+    if (first != -1)
+    {
+        const int first_vertex = caches[first].vertex_offset;
+        const int last_vertex = caches[last].vertex_offset + caches[last].num_vertices;
+        const int first_index = caches[first].first_index;
+        const int last_index = caches[last].first_index + caches[last].num_indices;
+        uint8_t* data = SDL_MapGPUTransferBuffer(device, ground_mesh.tbo, true);
+        if (!data)
+        {
+            SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
+            return false;
+        }
+        vertex_t* vertices = (vertex_t*) data;
+        uint32_t* indices = (uint32_t*) (data + (last_vertex - first_vertex) * sizeof(vertex_t));
+        for (int i = first; i <= last; i++)
+        {
+            const cache_t* cache = &caches[i];
+            memcpy(vertices + cache->vertex_offset - first_vertex, cache->vertices, cache->num_vertices * sizeof(vertex_t));
+            memcpy(indices + cache->first_index - first_index, cache->indices, cache->num_indices * sizeof(uint32_t));
+        }
+        upload_mesh(device, copy, &ground_mesh, sizeof(vertex_t), first_vertex, last_vertex, first_index, last_index);
+    }
+    for (int i = 0; i < num_chunks; i++)
+    {
+        caches[i].ground_pending = false;
+    }
+    return true;
+}
 
-model_t world_get_model(
-    const int x,
-    const int z)
+static bool upload_batch(
+    SDL_GPUDevice* device,
+    SDL_GPUCopyPass* copy)
 {
-    const int a = x - wx;
-    const int b = z - wz;
-    if (a < 0 || b < 0 || a >= wwidth || b >= wheight)
+    int first = -1;
+    int last = -1;
+    for (int i = 0; i < num_chunks; i++)
+    {
+        if (caches[i].batch_pending && caches[i].num_positions)
+        {
+            first = first == -1 ? i : first;
+            last = i;
+        }
+    }
+    if (first != -1)
+    {
+        const int first_position = caches[first].position_offset;
+        const int last_position = caches[last].position_offset + caches[last].num_positions;
+        const int first_index = caches[first].first_batch_index;
+        const int last_index = caches[last].first_batch_index + caches[last].num_batch_indices;
+        uint8_t* data = SDL_MapGPUTransferBuffer(device, batch_mesh.tbo, true);
+        if (!data)
+        {
+            SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
+            return false;
+        }
+        float* positions = (float*) data;
+        uint32_t* indices = (uint32_t*) (data + (last_position - first_position) * sizeof(float) * 3);
+        for (int i = first; i <= last; i++)
+        {
+            const cache_t* cache = &caches[i];
+            memcpy(positions + (cache->position_offset - first_position) * 3, cache->positions, cache->num_positions * sizeof(float) * 3);
+            memcpy(indices + cache->first_batch_index - first_index, cache->batch_indices, cache->num_batch_indices * sizeof(uint32_t));
+        }
+        upload_mesh(device, copy, &batch_mesh, sizeof(float) * 3, first_position, last_position, first_index, last_index);
+    }
+    for (int i = 0; i < num_chunks; i++)
     {
-        return MODEL_COUNT;
+        caches[i].batch_pending = false;
     }
-    return models[b * wwidth + a];
+    return true;
 }
 
-static void set_model(
-    const model_t model,
-    const int x,
-    const int z)
+/* uploads the marked parts of the instances and lights and the caches that
+changed. whatever fails stays marked or pending for the next update */
+static bool upload(
+    SDL_GPUDevice* device)
 {
-    const int a = x - wx;
-    const int b = z - wz;
-    if (a < 0 || b < 0 || a >= wwidth || b >= wheight)
+    layout_caches();
+    bool grown;
+    if (!reserve_mesh(device, &ground_mesh, sizeof(vertex_t), &grown))
     {
-        return;
+        return false;
+    }
+    for (int i = 0; grown && i < num_chunks; i++)
+    {
+        caches[i].ground_pending = true;
+    }
+    if (!reserve_mesh(device, &batch_mesh, sizeof(float) * 3, &grown))
+    {
+        return false;
+    }
+    for (int i = 0; grown && i < num_chunks; i++)
+    {
+        caches[i].batch_pending = true;
+    }
+    SDL_GPUCommandBuffer* commands = SDL_AcquireGPUCommandBuffer(device);
+    if (!commands)
+    {
+        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+        return false;
     }
-    models[b * wwidth + a] = model;
+    SDL_GPUCopyPass* copy = SDL_BeginGPUCopyPass(commands);
+    if (!copy)
+    {
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        SDL_CancelGPUCommandBuffer(commands);
+        return false;
+    }
+    bool status = upload_buffer(device, copy, &instance_buffer, num_instances, sizeof(int16_t) * 4);
+    status &= upload_buffer(device, copy, &light_buffer, lights, sizeof(float) * 4);
+    status &= upload_ground(device, copy);
+    status &= upload_batch(device, copy);
+    SDL_EndGPUCopyPass(copy);
+    SDL_SubmitGPUCommandBuffer(commands);
+    return status;
 }
 
-void world_free(
+/* data of untouched chunks moves to its new offsets through a copy of the old
+region, since moves can overlap in either direction */
+static bool apply_moves(
+    buffer_t* buffer,
+    const move_t* moves,
+    const int count,
+    const int stride)
+{
+    if (!count)
+    {
+        return true;
+    }
+    int first = moves[0].from;
+    int last = moves[0].from + moves[0].count;
+    for (int i = 1; i < count; i++)
+    {
+        first = min(first, moves[i].from);
+        last = max(last, moves[i].from + moves[i].count);
+    }
+    uint8_t* scratch = malloc((last - first) * stride);
+    if (!scratch)
+    {
+        SDL_Log("Failed to allocate scratch");
+        return false;
+    }
+    memcpy(scratch, buffer->data + first * stride, (last - first) * stride);
+    for (int i = 0; i < count; i++)
+    {
+        const move_t* move = &moves[i];
+        memcpy(buffer->data + move->to * stride, scratch + (move->from - first) * stride, move->count * stride);
+        mark_buffer(buffer, move->to, move->to + move->count);
+    }
+    free(scratch);
+    return true;
+}
+
+/* an edit only rescans the chunks it touched. the ranges and lights of the
+other chunks are unchanged and at most shift to new offsets, so they move
+within the cpu copies and only the parts of the buffers that changed are
+uploaded */
+static void patch(
     SDL_GPUDevice* device)
 {
-    free(models);
-    for (model_t model = 0; model < MODEL_COUNT; model++)
+    edited = false;
+    if (!count_chunks(false) || !update_types())
+    {
+        dirty = true;
+        return;
+    }
+    pool_run(build_chunk, NULL, num_chunks);
+    /* untouched spans are found in the old spans by walking both lists, which
+    are sorted by model and then by chunk */
+    move_t* instance_moves = NULL;
+    int j = 0;
+    for (int i = 0; i < stbds_arrlen(types); i++)
+    {
+        const type_t* type = &types[i];
+        while (j < stbds_arrlen(old_types) && old_types[j].model < type->model)
+        {
+            j++;
+        }
+        const span_t* old = NULL;
+        int num_old = 0;
+        if (j < stbds_arrlen(old_types) && old_types[j].model == type->model)
+        {
+            old = &old_spans[old_types[j].first_span];
+            num_old = old_types[j].num_spans;
+        }
+        int k = 0;
+        for (int l = 0; l < type->num_spans; l++)
+        {
+            const span_t* span = &spans[type->first_span + l];
+            const int count = is_ground(type->model) ? 1 : span->count;
+            if (chunks[span->chunk].edited)
+            {
+                mark_buffer(&instance_buffer, span->offset, span->offset + count);
+                continue;
+            }
+            while (k < num_old && old[k].chunk < span->chunk)
+            {
+                k++;
+            }
+            assert(k < num_old && old[k].chunk == span->chunk && old[k].count == span->count);
+            if (old[k].offset != span->offset)
+            {
+                const move_t move = { old[k].offset, span->offset, count };
+                stbds_arrput(instance_moves, move);
+            }
+        }
+    }
+    move_t* light_moves = NULL;
+    lights = 0;
+    for (int i = 0; i < num_chunks; i++)
     {
-        if (tbos[model])
+        chunk_t* chunk = &chunks[i];
+        if (chunk->edited)
         {
-            SDL_ReleaseGPUTransferBuffer(device, tbos[model]);
-            tbos[model] = NULL;
+            mark_buffer(&light_buffer, lights, lights + chunk->light_count);
         }
-        if (vbos[model])
+        else if (chunk->light_offset != (int) lights && chunk->light_count)
         {
-            SDL_ReleaseGPUBuffer(device, vbos[model]);
-            vbos[model] = NULL;
+            const move_t move = { chunk->light_offset, lights, chunk->light_count };
+            stbds_arrput(light_moves, move);
         }
+        chunk->light_offset = lights;
+        lights += chunk->light_count;
     }
-    if (light_tbo)
+    bool status = reserve_buffer(device, &instance_buffer, num_instances, sizeof(int16_t) * 4, SDL_GPU_BUFFERUSAGE_VERTEX) &&
+        reserve_buffer(device, &light_buffer, lights, sizeof(float) * 4, SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ) &&
+        apply_moves(&instance_buffer, instance_moves, stbds_arrlen(instance_moves), sizeof(int16_t) * 4) &&
+        apply_moves(&light_buffer, light_moves, stbds_arrlen(light_moves), sizeof(float) * 4);
+    stbds_arrfree(instance_moves);
+    stbds_arrfree(light_moves);
+    if (!status)
     {
-        SDL_ReleaseGPUTransferBuffer(device, light_tbo);
-        light_tbo = NULL;
+        dirty = true;
+        return;
     }
-    if (light_sbo)
+    fill_t fill = { (int16_t*) instance_buffer.data, (float*) light_buffer.data };
+    for (int i = 0; i < num_chunks; i++)
     {
-        SDL_ReleaseGPUBuffer(device, light_sbo);
-        light_sbo = NULL;
+        if (chunks[i].edited)
+        {
+            fill_chunk(&fill, i);
+            chunks[i].edited = false;
+        }
     }
-    memset(instances, 0, sizeof(instances));
-    memset(max_instances, 0, sizeof(max_instances));
-    models = NULL;
-    device = NULL;
+    dirty = !upload(device);
 }
 
 void world_update(
@@ -97,213 +1776,535 @@ void world_update(
     const int sz = floorf(z1 / MODEL_SIZE);
     const int ex = ceilf(x2 / MODEL_SIZE);
     const int ez = ceilf(z2 / MODEL_SIZE);
+    flush_edits();
+    if (model_update(device))
+    {
+        /* heights, slabs and occluder positions come from the new meshes */
+        for (int i = 0; i < cwidth * cheight; i++)
+        {
+            caches[i].dirty = true;
+        }
+        dirty = true;
+    }
     if (!dirty && sx == wx && sz == wz)
     {
-        return;
+        /* the view moves smoothly, so only refill once a chunk enters or leaves it */
+        bool changed = false;
+        for (int i = 0; i < num_chunks && !changed; i++)
+        {
+            changed = chunks[i].viewed != is_viewed(&chunks[i]) || chunks[i].shading != is_shading(&chunks[i]);
+        }
+        if (!changed)
+        {
+            if (edited)
+            {
+                patch(device);
+            }
+            return;
+        }
     }
     const int nwidth = ex - sx;
     const int nheight = ez - sz;
-    if (nwidth != wwidth || nheight != wheight)
+    const bool resized = nwidth != wwidth || nheight != wheight;
+    if (resized)
     {
-        free(models);
-        models = malloc(nwidth * nheight * sizeof(model_t));
-        if (!models)
+        /* padded to whole blocks, cache line aligned */
+        const int nbwidth = (nwidth + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE;
+        const int nbheight = (nheight + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE;
+        SDL_aligned_free(tiles);
+        tiles = SDL_aligned_alloc(64, nbwidth * nbheight * BLOCK_SIZE * sizeof(tile_t));
+        if (!tiles)
         {
-            SDL_Log("Failed to allocate models");
+            SDL_Log("Failed to allocate tiles");
+            wwidth = 0;
+            wheight = 0;
+            bwidth = 0;
+            bheight = 0;
             return;
         }
         wwidth = nwidth;
         wheight = nheight;
+        bwidth = nbwidth;
+        bheight = nbheight;
+    }
+    /* instances are stored relative to the window origin */
+    assert(wwidth <= INT16_MAX && wheight <= INT16_MAX);
+    const int cx1 = floorf((float) sx / WORLD_CHUNK_SIZE);
+    const int cz1 = floorf((float) sz / WORLD_CHUNK_SIZE);
+    const int cx2 = floorf((float) (ex - 1) / WORLD_CHUNK_SIZE) + 1;
+    const int cz2 = floorf((float) (ez - 1) / WORLD_CHUNK_SIZE) + 1;
+    num_chunks = (cx2 - cx1) * (cz2 - cz1);
+    if (num_chunks > max_chunks)
+    {
+        free(chunks);
+        chunks = malloc(num_chunks * sizeof(chunk_t));
+        if (!chunks)
+        {
+            SDL_Log("Failed to allocate chunks");
+            num_chunks = 0;
+            max_chunks = 0;
+            wwidth = 0;
+            wheight = 0;
+            return;
+        }
+        max_chunks = num_chunks;
     }
+    const int dx = sx - wx;
+    const int dz = sz - wz;
     wx = sx;
     wz = sz;
-    lights = 0;
-    memset(instances, 0, sizeof(instances));
-    memset(models, 0, wwidth * wheight * sizeof(model_t));
-    database_get_models(set_model, sx, sz, ex, ez);
-    for (int x = sx; x < ex; x++)
+    if (resized || abs(dx) >= wwidth || abs(dz) >= wheight)
     {
-        for (int z = sz; z < ez; z++)
+        load(sx, sz, ex, ez);
+    }
+    else
+    {
+        /* columns first, then the rows minus the corner they already cover */
+        int a1 = sx;
+        int a2 = ex;
+        if (dx > 0)
+        {
+            load(ex - dx, sz, ex, ez);
+            a2 = ex - dx;
+        }
+        else if (dx < 0)
         {
-            const model_t model = world_get_model(x, z);
-            instances[model]++;
-            lights += model_get_spread(model) > 0;
+            load(sx, sz, sx - dx, ez);
+            a1 = sx - dx;
+        }
+        if (dz > 0)
+        {
+            load(a1, ez - dz, a2, ez);
+        }
+        else if (dz < 0)
+        {
+            load(a1, sz, a2, sz - dz);
         }
     }
-    float* mdata[MODEL_COUNT] = {0};
-    float* ldata = NULL;
-    for (model_t model = 0; model < MODEL_COUNT; model++)
+    /* cached meshes follow their chunk when the chunk grid moves */
+    if (cx1 != cx || cz1 != cz || cx2 - cx1 != cwidth || cz2 - cz1 != cheight)
     {
-        if (!instances[model])
+        cache_t* next = calloc(num_chunks, sizeof(cache_t));
+        if (!next)
         {
-            continue;
+            SDL_Log("Failed to allocate caches");
+            num_chunks = 0;
+            wwidth = 0;
+            wheight = 0;
+            return;
         }
-        if (instances[model] > max_instances[model])
+        for (int i = 0; i < num_chunks; i++)
         {
-            max_instances[model] = 0;
-            if (tbos[model])
-            {
-                SDL_ReleaseGPUTransferBuffer(device, tbos[model]);
-                tbos[model] = NULL;
-            }
-            if (vbos[model])
+            const int x = cx1 + i % (cx2 - cx1);
+            const int z = cz1 + i / (cx2 - cx1);
+            next[i].dirty = true;
+            if (x < cx || z < cz || x >= cx + cwidth || z >= cz + cheight)
             {
-                SDL_ReleaseGPUBuffer(device, vbos[model]);
-                vbos[model] = NULL;
-            }
-            SDL_GPUTransferBufferCreateInfo tbci = {0};
-            tbci.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
-            tbci.size = instances[model] * sizeof(float) * 4;
-            tbos[model] = SDL_CreateGPUTransferBuffer(device, &tbci);
-            SDL_GPUBufferCreateInfo bci = {0};
-            bci.usage = SDL_GPU_BUFFERUSAGE_VERTEX;
-            bci.size = instances[model] * sizeof(float) * 4;
-            vbos[model] = SDL_CreateGPUBuffer(device, &bci);
-            if (!tbos[model] || !vbos[model])
-            {
-                SDL_Log("Failed to create buffer(s): %s", SDL_GetError());
-                return;
+                continue;
             }
-            max_instances[model] = instances[model];
+            cache_t* cache = &caches[(z - cz) * cwidth + x - cx];
+            next[i] = *cache;
+            memset(cache, 0, sizeof(cache_t));
         }
-        mdata[model] = SDL_MapGPUTransferBuffer(device, tbos[model], true);
-        if (!mdata[model])
+        for (int i = 0; i < cwidth * cheight; i++)
         {
-            SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
-            return;
+            free_cache(&caches[i]);
+        }
+        free(caches);
+        caches = next;
+        cx = cx1;
+        cz = cz1;
+        cwidth = cx2 - cx1;
+        cheight = cz2 - cz1;
+    }
+    for (int i = 0; i < num_chunks; i++)
+    {
+        chunk_t* chunk = &chunks[i];
+        chunk->x = cx1 + i % (cx2 - cx1);
+        chunk->z = cz1 + i / (cx2 - cx1);
+        chunk->viewed = is_viewed(chunk);
+        chunk->shading = is_shading(chunk);
+        chunk->edited = false;
+    }
+    edited = false;
+    if (!count_chunks(true) || !update_types())
+    {
+        num_chunks = 0;
+        wwidth = 0;
+        wheight = 0;
+        return;
+    }
+    pool_run(build_chunk, NULL, num_chunks);
+    lights = 0;
+    for (int i = 0; i < num_chunks; i++)
+    {
+        chunks[i].light_offset = lights;
+        lights += chunks[i].light_count;
+    }
+    if (!reserve_buffer(device, &instance_buffer, num_instances, sizeof(int16_t) * 4, SDL_GPU_BUFFERUSAGE_VERTEX) ||
+        !reserve_buffer(device, &light_buffer, lights, sizeof(float) * 4, SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ))
+    {
+        dirty = true;
+        return;
+    }
+    fill_t fill = { (int16_t*) instance_buffer.data, (float*) light_buffer.data };
+    pool_run(fill_chunk, &fill, num_chunks);
+    mark_buffer(&instance_buffer, 0, num_instances);
+    mark_buffer(&light_buffer, 0, lights);
+    dirty = !upload(device);
+}
+
+/* the record placing a ground mesh is the offset of its range */
+static int find_ground(
+    const chunk_t* chunk,
+    const model_t model)
+{
+    const range_t* ranges = get_ranges(chunk);
+    for (int i = 0; i < chunk->num_ranges; i++)
+    {
+        if (ranges[i].model == model)
+        {
+            return ranges[i].offset;
+        }
+    }
+    assert(false);
+    return 0;
+}
+
+static void add_draw(
+    SDL_GPUIndexedIndirectDrawCommand* draws,
+    int* num_draws,
+    const model_t model,
+    const bool proxy,
+    const int first,
+    const int count)
+{
+    SDL_GPUIndexedIndirectDrawCommand* draw = &draws[(*num_draws)++];
+    draw->num_instances = count;
+    draw->first_instance = first;
+    if (proxy)
+    {
+        draw->num_indices = model_get_num_proxy_indices(model);
+        draw->first_index = model_get_first_proxy_index(model);
+        draw->vertex_offset = model_get_proxy_vertex_offset(model);
+    }
+    else
+    {
+        draw->num_indices = model_get_num_indices(model);
+        draw->first_index = model_get_first_index(model);
+        draw->vertex_offset = model_get_vertex_offset(model);
+    }
+}
+
+void world_cull(
+    SDL_GPUDevice* device,
+    SDL_GPUCommandBuffer* commands,
+    const world_pass_t pass,
+    const camera_t* camera)
+{
+    assert(device);
+    assert(commands);
+    assert(pass < WORLD_PASS_COUNT);
+    assert(camera);
+    const stats_t stats[WORLD_PASS_COUNT] =
+    {
+        [WORLD_PASS_MODEL] = STATS_MODEL_CULLED,
+        [WORLD_PASS_RAY_MODEL_FRONT] = STATS_RAY_MODEL_FRONT_CULLED,
+        [WORLD_PASS_RAY_MODEL_BACK] = STATS_RAY_MODEL_BACK_CULLED,
+        [WORLD_PASS_SUN_MODEL] = STATS_SUN_MODEL_CULLED,
+    };
+    const stats_t triangles[WORLD_PASS_COUNT] =
+    {
+        [WORLD_PASS_MODEL] = STATS_MODEL_TRIANGLES,
+        [WORLD_PASS_RAY_MODEL_FRONT] = STATS_RAY_MODEL_FRONT_TRIANGLES,
+        [WORLD_PASS_RAY_MODEL_BACK] = STATS_RAY_MODEL_BACK_TRIANGLES,
+        [WORLD_PASS_SUN_MODEL] = STATS_SUN_MODEL_TRIANGLES,
+    };
+    const int masks[WORLD_PASS_COUNT] =
+    {
+        [WORLD_PASS_MODEL] = MODEL_PASS_MODEL,
+        [WORLD_PASS_RAY_MODEL_FRONT] = MODEL_PASS_RAY,
+        [WORLD_PASS_RAY_MODEL_BACK] = MODEL_PASS_RAY,
+        [WORLD_PASS_SUN_MODEL] = MODEL_PASS_SUN,
+    };
+    /* only the lit pass needs the full mesh, occlusion uses the hulls */
+    const bool proxies[WORLD_PASS_COUNT] =
+    {
+        [WORLD_PASS_MODEL] = false,
+        [WORLD_PASS_RAY_MODEL_FRONT] = true,
+        [WORLD_PASS_RAY_MODEL_BACK] = true,
+        [WORLD_PASS_SUN_MODEL] = true,
+    };
+    num_instanced[pass] = 0;
+    num_grounds[pass] = 0;
+    num_batches[pass] = 0;
+    if (!num_chunks)
+    {
+        return;
+    }
+    int culled = 0;
+    for (int i = 0; i < num_chunks; i++)
+    {
+        chunk_t* chunk = &chunks[i];
+        int x1;
+        int z1;
+        int x2;
+        int z2;
+        get_chunk_bounds(chunk, &x1, &z1, &x2, &z2);
+        chunk->visible[pass] = camera_intersect_box(
+            camera,
+            x1 * MODEL_SIZE - MODEL_SIZE / 2.0f,
+            0.0f,
+            z1 * MODEL_SIZE - MODEL_SIZE / 2.0f,
+            x2 * MODEL_SIZE - MODEL_SIZE / 2.0f,
+            chunk->height,
+            z2 * MODEL_SIZE - MODEL_SIZE / 2.0f);
+        if (chunk->visible[pass])
+        {
+            continue;
+        }
+        const range_t* ranges = get_ranges(chunk);
+        for (int j = 0; j < chunk->num_ranges; j++)
+        {
+            culled += ranges[j].count;
         }
-        instances[model] = 0;
     }
-    if (lights > max_lights)
+    stats_add(stats[pass], culled);
+    /* at most a run per span, a record per ground range and a batch per chunk */
+    const int capacity = stbds_arrlen(spans) + num_ground_draws + num_chunks;
+    if (capacity > max_draws[pass])
     {
-        max_lights = 0;
-        if (light_tbo)
+        max_draws[pass] = 0;
+        if (draw_tbos[pass])
         {
-            SDL_ReleaseGPUTransferBuffer(device, light_tbo);
-            light_tbo = NULL;
+            SDL_ReleaseGPUTransferBuffer(device, draw_tbos[pass]);
+            draw_tbos[pass] = NULL;
         }
-        if (light_sbo)
+        if (draw_ibos[pass])
         {
-            SDL_ReleaseGPUBuffer(device, light_sbo);
-            light_sbo = NULL;
+            SDL_ReleaseGPUBuffer(device, draw_ibos[pass]);
+            draw_ibos[pass] = NULL;
         }
         SDL_GPUTransferBufferCreateInfo tbci = {0};
         tbci.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
-        tbci.size = lights * sizeof(float) * 4;
-        light_tbo = SDL_CreateGPUTransferBuffer(device, &tbci);
+        tbci.size = capacity * sizeof(SDL_GPUIndexedIndirectDrawCommand);
+        draw_tbos[pass] = SDL_CreateGPUTransferBuffer(device, &tbci);
         SDL_GPUBufferCreateInfo bci = {0};
-        bci.usage = SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ;
-        bci.size = lights * sizeof(float) * 4;
-        light_sbo = SDL_CreateGPUBuffer(device, &bci);
-        if (!light_tbo || !light_sbo)
+        bci.usage = SDL_GPU_BUFFERUSAGE_INDIRECT;
+        bci.size = capacity * sizeof(SDL_GPUIndexedIndirectDrawCommand);
+        draw_ibos[pass] = SDL_CreateGPUBuffer(device, &bci);
+        if (!draw_tbos[pass] || !draw_ibos[pass])
         {
             SDL_Log("Failed to create buffer(s): %s", SDL_GetError());
             return;
         }
-        max_lights = lights;
+        max_draws[pass] = capacity;
     }
-    if (lights)
+    SDL_GPUIndexedIndirectDrawCommand* draws = SDL_MapGPUTransferBuffer(device, draw_tbos[pass], true);
+    if (!draws)
     {
-        ldata = SDL_MapGPUTransferBuffer(device, light_tbo, true);
-        if (!ldata)
+        SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
+        return;
+    }
+    /* merge visible chunks into runs, one draw record per run */
+    int count = 0;
+    int64_t submitted = 0;
+    int64_t masked = 0;
+    for (int i = 0; i < stbds_arrlen(types); i++)
+    {
+        const type_t* type = &types[i];
+        const model_t model = type->model;
+        if (is_ground(model) || (batched[pass] && is_occluder(model)))
         {
-            SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
-            return;
+            continue;
+        }
+        int64_t size = model_get_num_indices(model) / 3;
+        if (proxies[pass])
+        {
+            size = model_get_num_proxy_indices(model) / 3;
+        }
+        const span_t* first_span = &spans[type->first_span];
+        if (!(model_get_passes(model) & masks[pass]))
+        {
+            for (int j = 0; j < type->num_spans; j++)
+            {
+                if (chunks[first_span[j].chunk].visible[pass])
+                {
+                    masked += first_span[j].count * size;
+                }
+            }
+            continue;
+        }
+        int first = 0;
+        int num = 0;
+        for (int j = 0; j < type->num_spans; j++)
+        {
+            const span_t* span = &first_span[j];
+            if (chunks[span->chunk].visible[pass])
+            {
+                if (!num)
+                {
+                    first = span->offset;
+                }
+                num += span->count;
+                submitted += span->count * size;
+                continue;
+            }
+            if (num)
+            {
+                add_draw(draws, &count, model, proxies[pass], first, num);
+                num = 0;
+            }
+        }
+        if (num)
+        {
+            add_draw(draws, &count, model, proxies[pass], first, num);
         }
     }
-    lights = 0;
-    for (int x = sx; x < ex; x++)
+    num_instanced[pass] = count;
+    /* ground records follow the instanced ones, one per chunk and model */
+    for (int i = 0; i < num_chunks; i++)
     {
-        for (int z = sz; z < ez; z++)
+        const cache_t* cache = &caches[i];
+        if (!chunks[i].visible[pass])
+        {
+            continue;
+        }
+        for (int j = 0; j < cache->num_grounds; j++)
         {
-            const model_t model = world_get_model(x, z);
-            mdata[model][instances[model] * 4 + 0] = x * MODEL_SIZE;
-            mdata[model][instances[model] * 4 + 1] = 0.0f;
-            mdata[model][instances[model] * 4 + 2] = z * MODEL_SIZE;
-            mdata[model][instances[model] * 4 + 3] = 0.0f;
-            instances[model]++;
-            if (model_get_spread(model) <= 0)
+            const range_t* ground = &cache->grounds[j];
+            if (!(model_get_passes(ground->model) & masks[pass]))
             {
+                masked += ground->count / 3;
                 continue;
             }
-            ldata[lights * 4 + 0] = x * MODEL_SIZE;
-            ldata[lights * 4 + 1] = model_get_height(model);
-            ldata[lights * 4 + 2] = z * MODEL_SIZE;
-            ldata[lights * 4 + 3] = model_get_spread(model);
-            lights++;
+            SDL_GPUIndexedIndirectDrawCommand* draw = &draws[count++];
+            draw->num_indices = ground->count;
+            draw->num_instances = 1;
+            draw->first_index = cache->first_index + ground->offset;
+            draw->vertex_offset = cache->vertex_offset;
+            draw->first_instance = find_ground(&chunks[i], ground->model);
+            submitted += ground->count / 3;
         }
     }
-    SDL_GPUCommandBuffer* commands = SDL_AcquireGPUCommandBuffer(device);
-    if (!commands)
+    num_grounds[pass] = count - num_instanced[pass];
+    /* batched chunks close the list with one plain draw each */
+    first_batches[pass] = count;
+    for (int i = 0; batched[pass] && i < num_chunks; i++)
+    {
+        const cache_t* cache = &caches[i];
+        if (!chunks[i].visible[pass] || !cache->num_batch_indices)
+        {
+            continue;
+        }
+        SDL_GPUIndexedIndirectDrawCommand* draw = &draws[count++];
+        draw->num_indices = cache->num_batch_indices;
+        draw->num_instances = 1;
+        draw->first_index = cache->first_batch_index;
+        draw->vertex_offset = cache->position_offset;
+        draw->first_instance = 0;
+        submitted += cache->num_batch_indices / 3;
+    }
+    num_batches[pass] = count - first_batches[pass];
+    stats_add(triangles[pass], submitted);
+    stats_add(STATS_MASKED_TRIANGLES, masked);
+    SDL_UnmapGPUTransferBuffer(device, draw_tbos[pass]);
+    if (!count)
     {
-        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
         return;
     }
     SDL_GPUCopyPass* copy = SDL_BeginGPUCopyPass(commands);
     if (!copy)
     {
         SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        num_instanced[pass] = 0;
+        num_grounds[pass] = 0;
+        num_batches[pass] = 0;
         return;
     }
-    for (model_t model = 0; model < MODEL_COUNT; model++)
-    {
-        if (!mdata[model])
-        {
-            continue;
-        }
-        SDL_UnmapGPUTransferBuffer(device, tbos[model]);
-        SDL_GPUTransferBufferLocation location = {0};
-        SDL_GPUBufferRegion region = {0};
-        location.transfer_buffer = tbos[model];
-        region.buffer = vbos[model];
-        region.size = instances[model] * sizeof(float) * 4;
-        SDL_UploadToGPUBuffer(copy, &location, &region, true);
-    }
-    if (lights)
-    {
-        SDL_UnmapGPUTransferBuffer(device, light_tbo);
-        SDL_GPUTransferBufferLocation location = {0};
-        SDL_GPUBufferRegion region = {0};
-        location.transfer_buffer = light_tbo;
-        region.buffer = light_sbo;
-        region.size = lights * sizeof(float) * 4;
-        SDL_UploadToGPUBuffer(copy, &location, &region, true);
-    }
+    SDL_GPUTransferBufferLocation location = {0};
+    SDL_GPUBufferRegion region = {0};
+    location.transfer_buffer = draw_tbos[pass];
+    region.buffer = draw_ibos[pass];
+    region.size = count * sizeof(SDL_GPUIndexedIndirectDrawCommand);
+    SDL_UploadToGPUBuffer(copy, &location, &region, true);
     SDL_EndGPUCopyPass(copy);
-    SDL_SubmitGPUCommandBuffer(commands);
-    dirty = false;
 }
 
 void world_draw_models(
     SDL_GPUDevice* device,
+    SDL_GPUCommandBuffer* commands,
     SDL_GPURenderPass* pass,
+    const world_pass_t world_pass,
     SDL_GPUSampler* sampler)
 {
     assert(device);
+    assert(commands);
     assert(pass);
-    for (model_t model = 0; model < MODEL_COUNT; model++)
+    assert(world_pass < WORLD_PASS_COUNT);
+    if (batched[world_pass])
     {
-        if (!instances[model])
+        assert(!sampler);
+        if (!num_batches[world_pass])
         {
-            continue;
+            return;
         }
-        SDL_GPUBufferBinding vbb[2] = {0};
+        SDL_GPUBufferBinding vbb = {0};
         SDL_GPUBufferBinding ibb = {0};
-        vbb[0].buffer = model_get_vbo(model);
-        vbb[1].buffer = vbos[model];
-        ibb.buffer = model_get_ibo(model);
+        vbb.buffer = batch_mesh.vbo;
+        ibb.buffer = batch_mesh.ibo;
+        SDL_BindGPUVertexBuffers(pass, 0, &vbb, 1);
+        SDL_BindGPUIndexBuffer(pass, &ibb, SDL_GPU_INDEXELEMENTSIZE_32BIT);
+        SDL_DrawGPUIndexedPrimitivesIndirect(
+            pass,
+            draw_ibos[world_pass],
+            first_batches[world_pass] * sizeof(SDL_GPUIndexedIndirectDrawCommand),
+            num_batches[world_pass]);
+        return;
+    }
+    const int count = num_instanced[world_pass];
+    const int grounds = num_grounds[world_pass];
+    if (!count && !grounds)
+    {
+        return;
+    }
+    const int32_t origin[2] = { wx, wz };
+    SDL_GPUBufferBinding vbb[2] = {0};
+    SDL_GPUBufferBinding ibb = {0};
+    vbb[0].buffer = model_get_vbo();
+    vbb[1].buffer = instance_buffer.buffer;
+    ibb.buffer = model_get_ibo();
+    SDL_PushGPUVertexUniformData(commands, 1, origin, sizeof(origin));
+    SDL_BindGPUVertexBuffers(pass, 0, vbb, 2);
+    SDL_BindGPUIndexBuffer(pass, &ibb, model_get_index_size());
+    if (!sampler)
+    {
+        /* ground only takes part in passes with a palette */
+        assert(!grounds);
+        SDL_DrawGPUIndexedPrimitivesIndirect(pass, draw_ibos[world_pass], 0, count);
+        return;
+    }
+    /* every palette is a layer of one array so the instanced and the ground
+    records each go out in a single call */
+    SDL_GPUTextureSamplerBinding tsb = {0};
+    tsb.sampler = sampler;
+    tsb.texture = model_get_palette();
+    SDL_BindGPUFragmentSamplers(pass, 0, &tsb, 1);
+    if (count)
+    {
+        SDL_DrawGPUIndexedPrimitivesIndirect(pass, draw_ibos[world_pass], 0, count);
+    }
+    if (grounds)
+    {
+        vbb[0].buffer = ground_mesh.vbo;
+        ibb.buffer = ground_mesh.ibo;
         SDL_BindGPUVertexBuffers(pass, 0, vbb, 2);
         SDL_BindGPUIndexBuffer(pass, &ibb, SDL_GPU_INDEXELEMENTSIZE_32BIT);
-        if (sampler)
-        {
-            SDL_GPUTextureSamplerBinding tsb = {0};
-            tsb.sampler = sampler;
-            tsb.texture = model_get_palette(model);
-            SDL_BindGPUFragmentSamplers(pass, 0, &tsb, 1);
-        }
-        const int num_indices = model_get_num_indices(model);
-        const int count = instances[model];
-        SDL_DrawGPUIndexedPrimitives(pass, num_indices, count, 0, 0, 0);
+        SDL_DrawGPUIndexedPrimitivesIndirect(
+            pass,
+            draw_ibos[world_pass],
+            count * sizeof(SDL_GPUIndexedIndirectDrawCommand),
+            grounds);
     }
 }
 
@@ -319,18 +2320,97 @@ void world_draw_lights(
     {
         return;
     }
-    SDL_BindGPUFragmentStorageBuffers(pass, 0, &light_sbo, 1);
+    SDL_BindGPUFragmentStorageBuffers(pass, 0, &light_buffer.buffer, 1);
     SDL_PushGPUFragmentUniformData(commands, 3, &lights, 4);
     SDL_DrawGPUPrimitives(pass, 4, 1, 0, 0);
 }
 
+void world_set_view(
+    const float polygon[][2],
+    const int count)
+{
+    assert(polygon || !count);
+    assert(count <= CAMERA_MAX_POLYGON);
+    for (int i = 0; i < count; i++)
+    {
+        view[i][0] = polygon[i][0];
+        view[i][1] = polygon[i][1];
+    }
+    num_view = count;
+    update_shade();
+}
+
+void world_set_sun(
+    const float x,
+    const float y,
+    const float z)
+{
+    sun[0] = x;
+    sun[1] = y;
+    sun[2] = z;
+    update_shade();
+}
+
 void world_set_model(
     const model_t model,
     const int x,
     const int z)
 {
-    assert(model < MODEL_COUNT);
+    assert(model < model_get_count());
+    if (world_get_model(x, z) == model)
+    {
+        return;
+    }
+    /* the tile and the sides of its neighbours may change */
+    for (int i = 0; i < 4; i++)
+    {
+        const int a = floorf((float) (x + (i & 1 ? 1 : -1)) / WORLD_CHUNK_SIZE) - cx;
+        const int b = floorf((float) (z + (i & 2 ? 1 : -1)) / WORLD_CHUNK_SIZE) - cz;
+        if (a >= 0 && b >= 0 && a < cwidth && b < cheight)
+        {
+            caches[b * cwidth + a].dirty = true;
+        }
+    }
     set_model(model, x, z);
-    database_set_model(model, x, z);
+    const edit_t key = { x, z };
+    stbds_hmput(edits, key, model);
+    /* only the chunk of the tile has to be counted and filled again */
+    const int a = floorf((float) x / WORLD_CHUNK_SIZE) - cx;
+    const int b = floorf((float) z / WORLD_CHUNK_SIZE) - cz;
+    if (num_chunks && a >= 0 && b >= 0 && a < cwidth && b < cheight)
+    {
+        chunks[b * cwidth + a].edited = true;
+        edited = true;
+    }
+}
+
+void world_invalidate()
+{
+    dirty = true;
+}
+
+void world_set_batched(
+    const world_pass_t pass,
+    const bool value)
+{
+    assert(pass < WORLD_PASS_COUNT);
+    assert(pass != WORLD_PASS_MODEL);
+    if (batched[pass] == value)
+    {
+        return;
+    }
+    batched[pass] = value;
+    /* chunks are only baked while some pass is batched */
+    for (int i = 0; i < cwidth * cheight; i++)
+    {
+        caches[i].dirty = true;
+    }
     dirty = true;
+}
+
+bool world_get_batched(
+    const world_pass_t pass)
+{
+    assert(pass < WORLD_PASS_COUNT);
+    return batched[pass];
 }
\ No newline at end of file
@@ -1,8 +1,19 @@
 #pragma once
 
 #include <stdbool.h>
+#include "camera.h"
 #include "model.h"
 
+typedef enum
+{
+    WORLD_PASS_MODEL,
+    WORLD_PASS_RAY_MODEL_FRONT,
+    WORLD_PASS_RAY_MODEL_BACK,
+    WORLD_PASS_SUN_MODEL,
+    WORLD_PASS_COUNT,
+}
+world_pass_t;
+
 void world_free(
     SDL_GPUDevice* device);
 void world_update(
@@ -11,18 +22,40 @@ void world_update(
     const float z1,
     const float x2,
     const float z2);
+void world_cull(
+    SDL_GPUDevice* device,
+    SDL_GPUCommandBuffer* commands,
+    const world_pass_t pass,
+    const camera_t* camera);
 void world_draw_models(
     SDL_GPUDevice* device,
+    SDL_GPUCommandBuffer* commands,
     SDL_GPURenderPass* pass,
+    const world_pass_t world_pass,
     SDL_GPUSampler* sampler);
 void world_draw_lights(
     SDL_GPUDevice* device,
     SDL_GPUCommandBuffer* commands,
     SDL_GPURenderPass* pass);
+void world_set_view(
+    const float polygon[][2],
+    const int count);
+void world_set_sun(
+    const float x,
+    const float y,
+    const float z);
 void world_set_model(
     const model_t model,
     const int x,
     const int z);
+void world_invalidate();
 model_t world_get_model(
     const int x,
-    const int z);
\ No newline at end of file
+    const int z);
+int world_count(
+    int* counts);
+void world_set_batched(
+    const world_pass_t pass,
+    const bool batched);
+bool world_get_batched(
+    const world_pass_t pass);
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include <SDL3/SDL.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "reflect.h"
+
+/* compiles a spirv file into a header holding the code and the create info
+so the runtime skips the file io and reflection. usage: embed in out file */
+
+static void write_code(
+    FILE* stream,
+    const char* name,
+    const uint32_t* code,
+    const size_t size)
+{
+    fprintf(stream, "static const uint32_t %s_code[] =\n{", name);
+    for (size_t i = 0; i < size / 4; i++)
+    {
+        fprintf(stream, "%s0x%08x,", i % 8 ? " " : "\n    ", code[i]);
+    }
+    fprintf(stream, "\n};\n\n");
+}
+
+static void write_shader(
+    FILE* stream,
+    const char* name,
+    const SDL_GPUShaderCreateInfo* info)
+{
+    fprintf(stream, "static const SDL_GPUShaderCreateInfo %s =\n{\n", name);
+    fprintf(stream, "    .code_size = sizeof(%s_code),\n", name);
+    fprintf(stream, "    .code = (const Uint8*) %s_code,\n", name);
+    fprintf(stream, "    .entrypoint = \"%s\",\n", info->entrypoint);
+    fprintf(stream, "    .format = SDL_GPU_SHADERFORMAT_SPIRV,\n");
+    if (info->stage == SDL_GPU_SHADERSTAGE_VERTEX)
+    {
+        fprintf(stream, "    .stage = SDL_GPU_SHADERSTAGE_VERTEX,\n");
+    }
+    else
+    {
+        fprintf(stream, "    .stage = SDL_GPU_SHADERSTAGE_FRAGMENT,\n");
+    }
+    fprintf(stream, "    .num_samplers = %u,\n", info->num_samplers);
+    fprintf(stream, "    .num_storage_textures = %u,\n", info->num_storage_textures);
+    fprintf(stream, "    .num_storage_buffers = %u,\n", info->num_storage_buffers);
+    fprintf(stream, "    .num_uniform_buffers = %u,\n", info->num_uniform_buffers);
+    fprintf(stream, "};\n");
+}
+
+static void write_compute_pipeline(
+    FILE* stream,
+    const char* name,
+    const SDL_GPUComputePipelineCreateInfo* info)
+{
+    fprintf(stream, "static const SDL_GPUComputePipelineCreateInfo %s =\n{\n", name);
+    fprintf(stream, "    .code_size = sizeof(%s_code),\n", name);
+    fprintf(stream, "    .code = (const Uint8*) %s_code,\n", name);
+    fprintf(stream, "    .entrypoint = \"%s\",\n", info->entrypoint);
+    fprintf(stream, "    .format = SDL_GPU_SHADERFORMAT_SPIRV,\n");
+    fprintf(stream, "    .num_samplers = %u,\n", info->num_samplers);
+    fprintf(stream, "    .num_readonly_storage_textures = %u,\n", info->num_readonly_storage_textures);
+    fprintf(stream, "    .num_readonly_storage_buffers = %u,\n", info->num_readonly_storage_buffers);
+    fprintf(stream, "    .num_readwrite_storage_textures = %u,\n", info->num_readwrite_storage_textures);
+    fprintf(stream, "    .num_readwrite_storage_buffers = %u,\n", info->num_readwrite_storage_buffers);
+    fprintf(stream, "    .num_uniform_buffers = %u,\n", info->num_uniform_buffers);
+    fprintf(stream, "    .threadcount_x = %u,\n", info->threadcount_x);
+    fprintf(stream, "    .threadcount_y = %u,\n", info->threadcount_y);
+    fprintf(stream, "    .threadcount_z = %u,\n", info->threadcount_z);
+    fprintf(stream, "};\n");
+}
+
+int main(
+    int argc,
+    char** argv)
+{
+    if (argc != 4)
+    {
+        fprintf(stderr, "Usage: embed <input> <output> <file>\n");
+        return EXIT_FAILURE;
+    }
+    const char* file = argv[3];
+    int status = EXIT_SUCCESS;
+    uint32_t* code = NULL;
+    FILE* stream = NULL;
+    char name[256];
+    if (strlen(file) >= sizeof(name))
+    {
+        fprintf(stderr, "Failed to name shader: %s\n", file);
+        goto error;
+    }
+    /* batch.vert becomes batch_vert, matching the cmake target */
+    size_t length = 0;
+    for (; file[length]; length++)
+    {
+        name[length] = file[length] == '.' ? '_' : file[length];
+    }
+    name[length] = '\0';
+    stream = fopen(argv[1], "rb");
+    if (!stream)
+    {
+        fprintf(stderr, "Failed to open shader: %s\n", argv[1]);
+        goto error;
+    }
+    fseek(stream, 0, SEEK_END);
+    const long size = ftell(stream);
+    fseek(stream, 0, SEEK_SET);
+    code = malloc(size);
+    if (size <= 0 || size % 4 || !code || fread(code, 1, size, stream) != (size_t) size)
+    {
+        fprintf(stderr, "Failed to read shader: %s\n", argv[1]);
+        goto error;
+    }
+    fclose(stream);
+    stream = NULL;
+    SDL_GPUShaderCreateInfo shader = {0};
+    SDL_GPUComputePipelineCreateInfo pipeline = {0};
+    const bool compute = strstr(file, ".comp");
+    if (compute && !reflect_compute_pipeline(&pipeline, code, size))
+    {
+        fprintf(stderr, "Failed to reflect compute pipeline: %s\n", file);
+        goto error;
+    }
+    if (!compute && !reflect_shader(&shader, file, code, size))
+    {
+        fprintf(stderr, "Failed to reflect shader: %s\n", file);
+        goto error;
+    }
+    stream = fopen(argv[2], "wb");
+    if (!stream)
+    {
+        fprintf(stderr, "Failed to open header: %s\n", argv[2]);
+        goto error;
+    }
+    fprintf(stream, "/* generated from %s, do not edit */\n\n", file);
+    write_code(stream, name, code, size);
+    if (compute)
+    {
+        write_compute_pipeline(stream, name, &pipeline);
+    }
+    else
+    {
+        write_shader(stream, name, &shader);
+    }
+    if (fclose(stream))
+    {
+        stream = NULL;
+        fprintf(stderr, "Failed to write header: %s\n", argv[2]);
+        goto error;
+    }
+    stream = NULL;
+    goto success;
+error:
+    status = EXIT_FAILURE;
+success:
+    if (stream)
+    {
+        fclose(stream);
+    }
+    if (status != EXIT_SUCCESS)
+    {
+        remove(argv[2]);
+    }
+    free(code);
+    return status;
+}
\ No newline at end of file
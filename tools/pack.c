@@ -0,0 +1,165 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pack.h"
+
+/* packs loose files into one mappable file. usage: pack out files... */
+
+typedef struct
+{
+    pack_entry_t entry;
+    uint8_t* data;
+}
+file_t;
+
+static int compare(
+    const void* a,
+    const void* b)
+{
+    return strcmp(((const file_t*) a)->entry.name, ((const file_t*) b)->entry.name);
+}
+
+static uint64_t hash(
+    const uint8_t* data,
+    const uint64_t size)
+{
+    uint64_t value = 0xCBF29CE484222325;
+    for (uint64_t i = 0; i < size; i++)
+    {
+        value = (value ^ data[i]) * 0x100000001B3;
+    }
+    return value;
+}
+
+static uint8_t* load(
+    const char* path,
+    uint64_t* size)
+{
+    FILE* stream = fopen(path, "rb");
+    if (!stream)
+    {
+        return NULL;
+    }
+    fseek(stream, 0, SEEK_END);
+    const long length = ftell(stream);
+    fseek(stream, 0, SEEK_SET);
+    uint8_t* data = malloc(length > 0 ? length : 1);
+    if (length < 0 || !data || fread(data, 1, length, stream) != (size_t) length)
+    {
+        free(data);
+        fclose(stream);
+        return NULL;
+    }
+    fclose(stream);
+    *size = length;
+    return data;
+}
+
+int main(
+    int argc,
+    char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: pack <output> <files...>\n");
+        return EXIT_FAILURE;
+    }
+    const int num_files = argc - 2;
+    int status = EXIT_SUCCESS;
+    FILE* stream = NULL;
+    file_t* files = calloc(num_files > 0 ? num_files : 1, sizeof(file_t));
+    if (!files)
+    {
+        fprintf(stderr, "Failed to allocate files\n");
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < num_files; i++)
+    {
+        const char* path = argv[i + 2];
+        const char* name = path;
+        for (const char* c = path; *c; c++)
+        {
+            if (*c == '/' || *c == '\\')
+            {
+                name = c + 1;
+            }
+        }
+        if (strlen(name) >= PACK_NAME_SIZE)
+        {
+            fprintf(stderr, "Name is too long: %s\n", name);
+            goto error;
+        }
+        strcpy(files[i].entry.name, name);
+        files[i].data = load(path, &files[i].entry.size);
+        if (!files[i].data)
+        {
+            fprintf(stderr, "Failed to read file: %s\n", path);
+            goto error;
+        }
+        files[i].entry.hash = hash(files[i].data, files[i].entry.size);
+    }
+    /* sorted so the runtime can binary search the table in place */
+    qsort(files, num_files, sizeof(file_t), compare);
+    uint64_t offset = sizeof(pack_header_t) + num_files * sizeof(pack_entry_t);
+    for (int i = 0; i < num_files; i++)
+    {
+        if (i > 0 && !strcmp(files[i - 1].entry.name, files[i].entry.name))
+        {
+            fprintf(stderr, "Duplicate file: %s\n", files[i].entry.name);
+            goto error;
+        }
+        offset = (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+        files[i].entry.offset = offset;
+        offset += files[i].entry.size;
+    }
+    stream = fopen(argv[1], "wb");
+    if (!stream)
+    {
+        fprintf(stderr, "Failed to open pack: %s\n", argv[1]);
+        goto error;
+    }
+    pack_header_t header = {0};
+    header.magic = PACK_MAGIC;
+    header.version = PACK_VERSION;
+    header.num_entries = num_files;
+    bool written = fwrite(&header, sizeof(header), 1, stream) == 1;
+    for (int i = 0; i < num_files && written; i++)
+    {
+        written = fwrite(&files[i].entry, sizeof(pack_entry_t), 1, stream) == 1;
+    }
+    static const uint8_t padding[PACK_ALIGNMENT];
+    for (int i = 0; i < num_files && written; i++)
+    {
+        const long position = ftell(stream);
+        const size_t count = files[i].entry.offset - position;
+        written = fwrite(padding, 1, count, stream) == count;
+        written = written && fwrite(files[i].data, 1, files[i].entry.size, stream) == files[i].entry.size;
+    }
+    const bool closed = !fclose(stream);
+    stream = NULL;
+    if (!written || !closed)
+    {
+        fprintf(stderr, "Failed to write pack: %s\n", argv[1]);
+        goto error;
+    }
+    goto success;
+error:
+    status = EXIT_FAILURE;
+success:
+    if (stream)
+    {
+        fclose(stream);
+    }
+    if (status != EXIT_SUCCESS)
+    {
+        remove(argv[1]);
+    }
+    for (int i = 0; i < num_files; i++)
+    {
+        free(files[i].data);
+    }
+    free(files);
+    return status;
+}
\ No newline at end of file